@@ -0,0 +1,76 @@
+// Buffer 微基准: 对比改写前的 Buffer (OldBuffer, 见 oldbuffer.h) 和当前的 Buffer.
+// 每项测量单次操作的平均耗时, 两个版本交替运行两轮, 减少 CPU 频率变化的影响
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <sys/socket.h>
+
+#include "oldbuffer.h"
+#include "../code/buffer/buffer.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+static volatile size_t sink;                        // 防止编译器优化掉测量的操作
+
+// 运行 f(i) n 次, 返回平均每次的纳秒数
+template<class F>
+static double NsPerOp(long n, F f) {
+    auto start = Clock::now();
+    for(long i = 0; i < n; i++) { f(i); }
+    return chrono::duration<double, nano>(Clock::now() - start).count() / n;
+}
+
+template<class B>
+static void Run(const char* name) {
+    const long N = 2000000;
+    // 1. 新连接: 清空读写缓冲区
+    B r, w;
+    double accept = NsPerOp(N, [&](long) { w.RetrieveAll(); r.RetrieveAll(); sink += r.ReadableBytes(); });
+    // 2. 缓冲区曾经扩容到 64KB 后清空
+    B rg, wg;
+    string big(64 << 10, 'x');
+    rg.Append(big);
+    wg.Append(big);
+    double acceptBig = NsPerOp(N / 10, [&](long) { wg.RetrieveAll(); rg.RetrieveAll(); sink += rg.ReadableBytes(); });
+    // 3. 响应头: 8 次追加 (约 200 字节) 后清空
+    const string hdr[8] = { "HTTP/1.1 200 OK\r\n", "Connection: keep-alive\r\n", "keep-alive: max=6, timeout=120\r\n",
+                            "Date: Sun, 18 Oct 2026 08:00:00 GMT\r\n", "Content-type: text/html\r\n",
+                            "Content-length: 3079\r\n", "Accept-Ranges: bytes\r\n", "\r\n" };
+    B h;
+    double headers = NsPerOp(N, [&](long) { for(auto& s : hdr) { h.Append(s); } sink += h.ReadableBytes(); h.RetrieveAll(); });
+    // 4. 流水线: 一批 32 个响应头后清空
+    B p;
+    double pipeline = NsPerOp(N / 32, [&](long) {
+        for(int k = 0; k < 32; k++) { for(auto& s : hdr) { p.Append(s); } }
+        sink += p.ReadableBytes();
+        p.RetrieveAll();
+    });
+    // 5. 扩容: 新的缓冲区中以 100 字节为单位追加到 1MB
+    char chunk[100] = {};
+    double grow = NsPerOp(200, [&](long) { B g; for(int k = 0; k < 10486; k++) { g.Append(chunk, 100); } sink += g.ReadableBytes(); });
+    // 6. ReadFd: 从 socketpair 读取 512 字节的请求后取出
+    int sv[2];
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) { perror("socketpair"); return; }
+    char req[512] = {};
+    B rb;
+    int err = 0;
+    double readFd = NsPerOp(N / 4, [&](long) {
+        if(write(sv[0], req, sizeof(req)) < 0) { perror("write"); }
+        rb.ReadFd(sv[1], &err);
+        rb.Retrieve(rb.ReadableBytes());
+    });
+    close(sv[0]);
+    close(sv[1]);
+    printf("%-4s accept-clear %6.1f ns | clear-after-64K %7.1f ns | headers %6.1f ns | "
+           "pipeline-32 %7.1f ns | grow-1MB %8.0f ns | readfd-512 %6.0f ns\n",
+           name, accept, acceptBig, headers, pipeline, grow, readFd);
+}
+
+int main() {
+    for(int i = 0; i < 2; i++) {
+        Run<OldBuffer>("old");
+        Run<Buffer>("new");
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+// 写缓冲区微基准: 对比连续存储的 Buffer 和链式的 ChainBuffer (slab + 外部引用).
+// 每项测量一轮操作的平均耗时, 两个版本交替运行两轮, 减少 CPU 频率变化的影响
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "../code/buffer/buffer.h"
+#include "../code/buffer/chainbuffer.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+static volatile size_t sink;                        // 防止编译器优化掉测量的操作
+
+// 运行 f(i) n 次, 返回平均每次的纳秒数
+template<class F>
+static double NsPerOp(long n, F f) {
+    auto start = Clock::now();
+    for(long i = 0; i < n; i++) { f(i); }
+    return chrono::duration<double, nano>(Clock::now() - start).count() / n;
+}
+
+// 响应头 (约 200 字节), 与 buffer_bench 相同
+static const string HDR[8] = { "HTTP/1.1 200 OK\r\n", "Connection: keep-alive\r\n", "keep-alive: max=6, timeout=120\r\n",
+                               "Date: Sun, 18 Oct 2026 08:00:00 GMT\r\n", "Content-type: text/html\r\n",
+                               "Content-length: 3079\r\n", "Accept-Ranges: bytes\r\n", "\r\n" };
+static const string BODY(3079, 'x');                // 缓存的文件内容 (index.html 的大小)
+
+// 整理可读数据为 iovec (写出之前的最后一步): Buffer 只有一段
+static int Gather(Buffer& b, struct iovec* iov) {
+    iov[0].iov_base = const_cast<char*>(b.Peek());
+    iov[0].iov_len = b.ReadableBytes();
+    return 1;
+}
+
+static int Gather(ChainBuffer& b, struct iovec* iov) {
+    return b.PeekIov(iov, nullptr, 128);
+}
+
+// 追加文件内容: Buffer 只能复制, ChainBuffer 追加引用
+static void AppendBody(Buffer& b) { b.Append(BODY); }
+static void AppendBody(ChainBuffer& b) { b.AppendRef(BODY.data(), BODY.size()); }
+
+template<class B>
+static void Run(const char* name) {
+    // 1. 以 4KB 为单位追加到 4MB 后清空 (大响应、请求体)
+    char chunk[4096] = {};
+    double build = NsPerOp(50, [&](long) {
+        B b;
+        for(int k = 0; k < 1024; k++) { b.Append(chunk, sizeof(chunk)); }
+        sink += b.ReadableBytes();
+    });
+    // 2. 流水线: 32 个响应 (头部 + 3KB 文件内容) 追加后整理为 iovec, 然后取出
+    B p;
+    struct iovec iov[128];
+    double pipeline = NsPerOp(100000, [&](long) {
+        for(int k = 0; k < 32; k++) {
+            for(auto& s : HDR) { p.Append(s); }
+            AppendBody(p);
+        }
+        sink += Gather(p, iov);
+        p.RetrieveAll();
+    });
+    // 3. ReadFd: 从 socketpair 读入 1MB 的请求体 (每次写入 64KB 后读完)
+    int sv[2];
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) { perror("socketpair"); return; }
+    static char block[64 * 1024] = {};
+    int err = 0;
+    double readBody = NsPerOp(200, [&](long) {
+        B r;
+        for(int k = 0; k < 16; k++) {
+            size_t want = r.ReadableBytes() + sizeof(block);
+            if(write(sv[0], block, sizeof(block)) < 0) { perror("write"); }
+            while(r.ReadableBytes() < want && r.ReadFd(sv[1], &err) > 0) {}
+        }
+        sink += r.ReadableBytes();
+    });
+    close(sv[0]);
+    close(sv[1]);
+    printf("%-12s build-4MB %8.0f ns | pipeline-32x3KB %7.0f ns | read-1MB %8.0f ns\n",
+           name, build, pipeline, readBody);
+}
+
+int main() {
+    for(int i = 0; i < 2; i++) {
+        Run<Buffer>("Buffer");
+        Run<ChainBuffer>("ChainBuffer");
+    }
+    return 0;
+}
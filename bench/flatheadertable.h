@@ -0,0 +1,72 @@
+// 不用完美哈希的头部字段表, 只用于 headertable_bench 对比: 接口与 HeaderTable 相同,
+// 所有字段按出现顺序放在内联数组中 (与改为固定槽位之前的存储方式相同), 查找常用字段时逐个比较名称.
+// 名称同样不区分大小写, 比较方式与 HeaderTable 确认槽位时相同
+#ifndef FLAT_HEADER_TABLE_H
+#define FLAT_HEADER_TABLE_H
+
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "../code/http/headertable.h"
+
+class FlatHeaderTable {
+public:
+    typedef HeaderTable::Slice Slice;
+
+    explicit FlatHeaderTable(const char* base) : base_(base) { Clear(); }
+
+    void Clear() {
+        count_ = 0;
+        spill_.clear();
+    }
+    void Add(std::string_view, Slice key, Slice value) {
+        if(count_ < INLINE_HEADERS) { headers_[count_++] = Header{key, value}; }
+        else { spill_.push_back(Header{key, value}); }
+    }
+    Slice Get(HeaderTable::HEADER id) const {
+        std::string_view name = NAMES[id];
+        for(size_t i = 0; i < count_; i++) {
+            if(Match_(headers_[i].key, name)) { return headers_[i].value; }
+        }
+        for(const Header& h : spill_) {
+            if(Match_(h.key, name)) { return h.value; }
+        }
+        return Slice{0, 0};
+    }
+
+private:
+    struct Header {
+        Slice key;
+        Slice value;
+    };
+    // 与小写的常用字段名比较, 每次比较 8 个字节 (名称已校验为 token)
+    bool Match_(Slice key, std::string_view lowerName) const {
+        if(key.len != lowerName.size()) { return false; }
+        const char* p = base_ + key.off;
+        const uint64_t CASE_BITS = 0x2020202020202020ULL;
+        size_t i = 0;
+        for(; i + 8 <= key.len; i += 8) {
+            uint64_t a, b;
+            memcpy(&a, p + i, 8);
+            memcpy(&b, lowerName.data() + i, 8);
+            if((a | CASE_BITS) != b) { return false; }
+        }
+        for(; i < key.len; i++) {
+            if((p[i] | 0x20) != lowerName[i]) { return false; }
+        }
+        return true;
+    }
+
+    static constexpr std::string_view NAMES[HeaderTable::HDR_COUNT] = {
+        "host", "connection", "content-type", "content-length", "transfer-encoding",
+        "accept-encoding", "if-none-match", "if-modified-since", "range", "if-range",
+    };
+    static const size_t INLINE_HEADERS = 16;
+    const char* base_;                              // 请求的起始位置 (比较名称时使用)
+    Header headers_[INLINE_HEADERS];
+    size_t count_;
+    std::vector<Header> spill_;
+};
+
+#endif //FLAT_HEADER_TABLE_H
@@ -0,0 +1,102 @@
+// 请求解析微基准: 对比改写前的正则解析 (OldHttpRequest, 见 oldhttprequest.h) 和当前的 HttpRequest.
+// 每项测量解析一个完整请求的平均耗时 (含把请求写入缓冲区), 两个版本交替运行两轮, 减少 CPU 频率变化的影响
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include "oldhttprequest.h"
+#include "../code/http/httprequest.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+static volatile size_t sink;                        // 防止编译器优化掉测量的操作
+
+// 运行 f(i) n 次, 返回平均每次的纳秒数
+template<class F>
+static double NsPerOp(long n, F f) {
+    auto start = Clock::now();
+    for(long i = 0; i < n; i++) { f(i); }
+    return chrono::duration<double, nano>(Clock::now() - start).count() / n;
+}
+
+// 浏览器发出的 GET 请求 (14 个头部字段)
+static const string BROWSER_GET =
+    "GET /index.html HTTP/1.1\r\n"
+    "Host: 127.0.0.1:1316\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "sec-ch-ua: \"Chromium\";v=\"128\", \"Not;A=Brand\";v=\"24\"\r\n"
+    "sec-ch-ua-mobile: ?0\r\n"
+    "sec-ch-ua-platform: \"Linux\"\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/128.0.0.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+    "Sec-Fetch-Site: none\r\n"
+    "Sec-Fetch-Mode: navigate\r\n"
+    "Sec-Fetch-Dest: document\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "\r\n";
+
+// 带 Cookie 的请求 (约 1.2KB)
+static const string COOKIE_GET = [] {
+    string req = BROWSER_GET.substr(0, BROWSER_GET.size() - 2);
+    req += "Cookie: session=";
+    req += string(600, 'a');
+    req += "; theme=dark; lang=zh-CN\r\n\r\n";
+    return req;
+}();
+
+// 表单登录的 POST 请求
+static const string FORM_POST =
+    "POST /login HTTP/1.1\r\n"
+    "Host: 127.0.0.1:1316\r\n"
+    "Connection: keep-alive\r\n"
+    "Content-Type: application/x-www-form-urlencoded\r\n"
+    "Content-Length: 29\r\n"
+    "\r\n"
+    "username=test&password=123456";
+
+// 改写前: parse 逐行取出缓冲区中的数据
+static double OldParse(long n, const string& req) {
+    OldHttpRequest request;
+    OldBuffer buff;
+    return NsPerOp(n, [&](long) {
+        buff.Append(req);
+        request.Init();
+        request.parse(buff);
+        sink += request.IsKeepAlive();
+        buff.RetrieveAll();
+    });
+}
+
+// 当前: parse 不移动读指针, 由调用者根据 Consumed() 取出
+static double NewParse(long n, const string& req) {
+    HttpRequest request;
+    Buffer buff;
+    return NsPerOp(n, [&](long) {
+        buff.Append(req);
+        request.Init();
+        if(request.parse(buff) != HttpRequest::GET_REQUEST) { sink += 1; }
+        sink += request.IsKeepAlive();
+        buff.Retrieve(request.Consumed());
+    });
+}
+
+// 对比两个版本解析同一个请求, 正则版本很慢, 运行次数少一些
+static void Run(const char* name, const string& req) {
+    double oldNs = OldParse(2000, req);
+    double newNs = NewParse(1000000, req);
+    printf("%-12s %5zu B | regex %9.0f ns | new %6.1f ns (%5.2f GB/s) | %6.0fx\n",
+           name, req.size(), oldNs, newNs, req.size() / newNs, oldNs / newNs);
+}
+
+int main() {
+    for(int i = 0; i < 2; i++) {
+        Run("browser-get", BROWSER_GET);
+        Run("cookie-get", COOKIE_GET);
+        Run("form-post", FORM_POST);
+    }
+    return 0;
+}
@@ -0,0 +1,146 @@
+// 分隔符扫描微基准: 按解析器的方式扫描请求 (每行找 '\n', 请求行找方法后的空格和两个空格, 头部行找名称后的 ':'),
+// 对比改写前的 memchr (不校验 token)、标量实现、SSE4.2 和 AVX2 实现, 以及运行时实际选用的实现.
+// 各实现是 httpscan.cpp 中的静态函数, 这里直接包含该文件来调用它们; CPU 不支持的实现跳过
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "../code/http/httpscan.cpp"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+static volatile size_t sink;                        // 防止编译器优化掉测量的操作
+
+// 运行 f(i) n 次, 返回平均每次的纳秒数
+template<class F>
+static double NsPerOp(long n, F f) {
+    auto start = Clock::now();
+    for(long i = 0; i < n; i++) { f(i); }
+    return chrono::duration<double, nano>(Clock::now() - start).count() / n;
+}
+
+typedef const char* (*FindCharFn)(const char*, const char*, char);
+typedef const char* (*FindTokenEndFn)(const char*, const char*);
+
+static const char* MemchrChar(const char* begin, const char* end, char ch) {
+    const void* p = memchr(begin, ch, end - begin);
+    return p ? static_cast<const char*>(p) : end;
+}
+
+// 改写前没有 token 校验, 头部名称直接用 memchr 找 ':' (请求行找空格)
+static const char* MemchrColon(const char* begin, const char* end) {
+    const char* sp = MemchrChar(begin, end, ' ');
+    const char* colon = MemchrChar(begin, sp, ':');
+    return colon < sp ? colon : sp;
+}
+
+static const char* DispatchChar(const char* begin, const char* end, char ch) {
+    return HttpScan::FindChar(begin, end, ch);
+}
+
+static const char* DispatchTokenEnd(const char* begin, const char* end) {
+    return HttpScan::FindTokenEnd(begin, end);
+}
+
+// 扫描一个请求的所有分隔符, 返回各分隔符偏移之和 (用于校验各实现结果一致)
+static size_t ScanRequest(const string& req, FindCharFn findChar, FindTokenEndFn findTokenEnd) {
+    const char* p = req.data();
+    const char* end = p + req.size();
+    size_t sum = 0;
+    bool requestLine = true;
+    while(p < end) {
+        const char* lineEnd = findChar(p, end, '\n');
+        const char* e = (lineEnd > p && lineEnd[-1] == '\r') ? lineEnd - 1 : lineEnd;
+        if(e == p) { break; }                       // 空行, 头部结束
+        const char* tok = findTokenEnd(p, e);
+        sum += tok - req.data();
+        if(requestLine) {
+            const char* sp2 = findChar(tok + 1, e, ' ');
+            sum += sp2 - req.data();
+            sum += findChar(sp2 + 1, e, ' ') - req.data();
+            requestLine = false;
+        }
+        sum += lineEnd - req.data();
+        p = lineEnd + 1;
+    }
+    return sum;
+}
+
+// 浏览器发出的 GET 请求 (14 个头部字段), 与 parser_bench 相同
+static const string BROWSER_GET =
+    "GET /index.html HTTP/1.1\r\n"
+    "Host: 127.0.0.1:1316\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "sec-ch-ua: \"Chromium\";v=\"128\", \"Not;A=Brand\";v=\"24\"\r\n"
+    "sec-ch-ua-mobile: ?0\r\n"
+    "sec-ch-ua-platform: \"Linux\"\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/128.0.0.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+    "Sec-Fetch-Site: none\r\n"
+    "Sec-Fetch-Mode: navigate\r\n"
+    "Sec-Fetch-Dest: document\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "\r\n";
+
+// 带 Cookie 的请求 (约 1.2KB)
+static const string COOKIE_GET = [] {
+    string req = BROWSER_GET.substr(0, BROWSER_GET.size() - 2);
+    req += "Cookie: session=";
+    req += string(600, 'a');
+    req += "; theme=dark; lang=zh-CN\r\n\r\n";
+    return req;
+}();
+
+struct Impl {
+    const char* name;
+    FindCharFn findChar;
+    FindTokenEndFn findTokenEnd;
+    bool supported;
+};
+
+static void Run(const char* name, const string& req) {
+    bool x86Sse = false, x86Avx2 = false;
+    FindCharFn sseChar = FindCharScalar, avx2Char = FindCharScalar;
+    FindTokenEndFn sseToken = FindTokenEndScalar;
+#ifdef HTTP_SCAN_X86
+    x86Sse = __builtin_cpu_supports("sse4.2");
+    x86Avx2 = __builtin_cpu_supports("avx2");
+    sseChar = FindCharSse42;
+    avx2Char = FindCharAvx2;
+    sseToken = FindTokenEndSse42;
+#endif
+    const Impl impls[] = {
+        { "memchr", MemchrChar, MemchrColon, true },
+        { "scalar", FindCharScalar, FindTokenEndScalar, true },
+        { "sse4.2", sseChar, sseToken, x86Sse },
+        { "avx2", avx2Char, sseToken, x86Avx2 },
+        { HttpScan::Isa(), DispatchChar, DispatchTokenEnd, true },
+    };
+    const long N = 1000000;
+    size_t expect = ScanRequest(req, FindCharScalar, FindTokenEndScalar);
+    printf("%-12s %5zu B |", name, req.size());
+    for(size_t k = 0; k < sizeof(impls) / sizeof(impls[0]); k++) {
+        const Impl& impl = impls[k];
+        if(!impl.supported) { continue; }
+        if(ScanRequest(req, impl.findChar, impl.findTokenEnd) != expect) {
+            printf(" %s MISMATCH |", impl.name);
+            continue;
+        }
+        double ns = NsPerOp(N, [&](long) { sink += ScanRequest(req, impl.findChar, impl.findTokenEnd); });
+        printf(" %s%s %6.1f ns |", k + 1 == sizeof(impls) / sizeof(impls[0]) ? "used=" : "", impl.name, ns);
+    }
+    printf("\n");
+}
+
+int main() {
+    for(int i = 0; i < 2; i++) {
+        Run("browser-get", BROWSER_GET);
+        Run("cookie-get", COOKIE_GET);
+    }
+    return 0;
+}
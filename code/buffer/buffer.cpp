@@ -1,7 +1,7 @@
 #include "buffer.h"
 
-// 构造函数，初始化缓冲区和读写位置
-Buffer::Buffer(int initBuffSize) : buffer_(initBuffSize), readPos_(0), writePos_(0) {}
+// 构造函数，初始化缓冲区和读写位置 (内存不初始化)
+Buffer::Buffer(int initBuffSize) : buffer_(new char[initBuffSize]), capacity_(initBuffSize), readPos_(0), writePos_(0) {}
 
 // 返回剩余可读字节数
 size_t Buffer::ReadableBytes() const {
@@ -10,7 +10,7 @@ size_t Buffer::ReadableBytes() const {
 
 // 返回可写字节数
 size_t Buffer::WritableBytes() const {
-    return buffer_.size() - writePos_;
+    return capacity_ - writePos_;
 }
 
 // 表示前面的已读位置, 可以重复使用, 装别的数据
@@ -23,10 +23,13 @@ const char* Buffer::Peek() const {
     return BeginPtr_() + readPos_;
 }
 
-// 从缓冲区中取出指定长度的数据, 并将读指针向前移动
+// 从缓冲区中取出指定长度的数据, 并将读指针向前移动; 数据全部取出后回到开头, 之后追加时不需要移动数据
 void Buffer::Retrieve(size_t len) {
     assert(len <= ReadableBytes());
     readPos_ += len;
+    if(readPos_ == writePos_) {
+        readPos_ = writePos_ = 0;
+    }
 }
 
 // 从缓冲区中取出数据，直到指定的结束位置
@@ -35,11 +38,8 @@ void Buffer::RetrieveUntil(const char* end) {
     Retrieve(end - Peek());
 }
 
-// 清空缓冲区，将缓冲区的内容全部重置为初始状态，以便重新使用
+// 清空缓冲区: 只重置读写位置, 旧的内容会被之后写入的数据覆盖, 不需要清零
 void Buffer::RetrieveAll() {
-    // 使用 bzero 函数将缓冲区的内容全部置为零，相当于清空缓冲区
-    bzero(&buffer_[0], buffer_.size());                 
-    // 重置读写位置，使缓冲区可以重新写入新的数据
     readPos_ = 0;
     writePos_ = 0;
 }
@@ -64,7 +64,7 @@ char* Buffer::BeginWrite() {
 // 更新已写入数据的位置
 void Buffer::HasWritten(size_t len) {
     writePos_ += len;
-} 
+}
 
 // 向缓冲区追加字符串
 void Buffer::Append(const std::string& str) {
@@ -93,21 +93,31 @@ void Buffer::Append(const Buffer& buff) {
 // 如果可写空间不足，扩充缓冲区
 void Buffer::EnsureWriteable(size_t len) {
     if(WritableBytes() < len) {
-        MakeSpace_(len);                            // 追加原来 buff_ 的大小, 使其可以装下全部数据 
+        MakeSpace_(len);                            // 追加原来 buff_ 的大小, 使其可以装下全部数据
     }
     assert(WritableBytes() >= len);
 }
 
 // 从 fd 所对应的文件中，读取数据到缓冲区中
+// 可写空间不足时多读到当前线程共享的临时缓冲区 (只在第一次使用时分配), 再追加到缓冲区中
 ssize_t Buffer::ReadFd(int fd, int* saveErrno) {
-    char buff[65535];                               // 临时缓冲区
+    const size_t writable = WritableBytes();
+    if(writable >= SPILL_SIZE) {                    // 空间足够时直接读入, 不需要临时缓冲区
+        const ssize_t len = read(fd, BeginWrite(), writable);
+        if(len < 0) {
+            *saveErrno = errno;
+        } else {
+            writePos_ += len;
+        }
+        return len;
+    }
+    thread_local std::unique_ptr<char[]> spill(new char[SPILL_SIZE]);
     // 分散读, 一块指向当前 buffer_，一块指向临时缓冲区
     struct iovec iov[2];                            // 用于readv函数的两个iovec结构体，iov[0]用于写入数据到缓冲区，iov[1]用于保存多余的数据
-    const size_t writable = WritableBytes();        // 设置iov[0]，指向当前可写位置，长度为可写字节数
-    iov[0].iov_base = BeginPtr_() + writePos_;      // 分散读， 保证数据全部读完
+    iov[0].iov_base = BeginWrite();                 // 分散读， 保证数据全部读完
     iov[0].iov_len = writable;
-    iov[1].iov_base = buff;                         // 设置iov[1]，指向临时缓冲区，长度为临时缓冲区的大小
-    iov[1].iov_len = sizeof(buff);
+    iov[1].iov_base = spill.get();                  // 设置iov[1]，指向临时缓冲区，长度为临时缓冲区的大小
+    iov[1].iov_len = SPILL_SIZE;
 
     const ssize_t len = readv(fd, iov, 2);          // 从文件描述符fd中读取数据到缓冲区
     if(len < 0) {
@@ -117,8 +127,8 @@ ssize_t Buffer::ReadFd(int fd, int* saveErrno) {
         writePos_ += len;                           // 更新写入位置
     }
     else {
-        writePos_ = buffer_.size();
-        Append(buff, len - writable);               // 写入剩余的内容到到临时缓冲区
+        writePos_ = capacity_;
+        Append(spill.get(), len - writable);        // 写入剩余的内容到到临时缓冲区
     }
     return len;
 }
@@ -130,31 +140,49 @@ ssize_t Buffer::WriteFd(int fd, int* saveErrno) {
     if(len < 0) {
         *saveErrno = errno;                         // 处理写入结果
         return len;
-    } 
+    }
     readPos_ += len;                                // 更新读取位置
     return len;
 }
 
+// 收缩到 watermark, 未读数据超过 watermark 时不收缩
+void Buffer::ShrinkTo(size_t watermark) {
+    if(capacity_ > watermark && ReadableBytes() <= watermark) {
+        Reallocate_(watermark);
+    }
+}
+
 // 返回缓冲区的起始地址
 char* Buffer::BeginPtr_() {
-    return &*buffer_.begin();
+    return buffer_.get();
 }
 
 // 返回只读缓冲区的起始地址
 const char* Buffer::BeginPtr_() const {
-    return &*buffer_.begin();
+    return buffer_.get();
 }
 
-// 如果剩余的可写和可读空间都不足以容纳len大小的数据，则进行扩容
+// 可写空间不足时: 已读部分足够 (且未读数据不多于一半容量) 时把未读数据移到开头;
+// 否则按倍数扩容, 连续追加时复制的总量与数据量成线性关系
 void Buffer::MakeSpace_(size_t len) {
-    if(WritableBytes() + PrependableBytes() < len) {// 已经读取的数据 + 还需写入的数据 < len
-        buffer_.resize(writePos_ + len + 1);       
-    } 
-    else {                                          // 将未读数据向前移动，以便腾出空间
-        size_t readable = ReadableBytes();
+    size_t readable = ReadableBytes();
+    if(WritableBytes() + PrependableBytes() >= len && readable <= capacity_ / 2) {
         std::copy(BeginPtr_() + readPos_, BeginPtr_() + writePos_, BeginPtr_());
         readPos_ = 0;
-        writePos_ = readPos_ + readable;
-        assert(readable == ReadableBytes());
+        writePos_ = readable;
+        return;
     }
+    Reallocate_(std::max(capacity_ * 2, readable + len));
+}
+
+// 换成新的内存, 只复制未读数据
+void Buffer::Reallocate_(size_t capacity) {
+    size_t readable = ReadableBytes();
+    assert(capacity >= readable);
+    std::unique_ptr<char[]> buffer(new char[capacity]);
+    std::copy(BeginPtr_() + readPos_, BeginPtr_() + writePos_, buffer.get());
+    buffer_ = std::move(buffer);
+    capacity_ = capacity;
+    readPos_ = 0;
+    writePos_ = readable;
 }
\ No newline at end of file
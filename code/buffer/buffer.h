@@ -4,11 +4,14 @@
 #include <iostream>
 #include <unistd.h>                             // 用于使用 write 函数
 #include <sys/uio.h>                            // 用于使用 readv 函数
-#include <vector>                      
+#include <vector>
+#include <memory>
 #include <atomic>
 #include <assert.h>
 
 // 缓冲区类 定义
+// 同一时刻只由一个线程使用 (连接由 EPOLLONESHOT 保证, 日志由互斥锁保证), 读写位置不需要原子操作.
+// 内存不做初始化, 清空只重置读写位置; 空间不足时按倍数扩容, 空闲时可以收缩
 class Buffer {
 public:
     // 构造函数，初始化缓冲区大小，默认为1024字节
@@ -51,6 +54,10 @@ public:
     ssize_t ReadFd(int fd, int* Errno);
     // 将缓冲区的数据写入文件描述符
     ssize_t WriteFd(int fd, int* Errno);
+    // 容量超过 watermark 时收缩到 watermark (不小于未读数据), 用于空闲的连接释放扩容的内存
+    void ShrinkTo(size_t watermark);
+    // 返回缓冲区的容量
+    size_t Capacity() const { return capacity_; }
 
 private:
     // 获取缓冲区数据起始位置的指针（非const版本）
@@ -59,12 +66,18 @@ private:
     const char* BeginPtr_() const;
     // 确保缓冲区有足够的空间
     void MakeSpace_(size_t len);
-    // 缓冲区数据存储的容器
-    std::vector<char> buffer_;
-    // 读取位置的原子变量
-    std::atomic<std::size_t> readPos_;
-    // 写入位置的原子变量
-    std::atomic<std::size_t> writePos_;
+    // 换成 capacity 大小的内存, 未读数据移到开头
+    void Reallocate_(size_t capacity);
+    // 缓冲区数据存储的内存 (不初始化)
+    std::unique_ptr<char[]> buffer_;
+    // 缓冲区的容量
+    size_t capacity_;
+    // 读取位置
+    size_t readPos_;
+    // 写入位置
+    size_t writePos_;
+
+    static const size_t SPILL_SIZE = 65536;     // 每个线程共享的临时读缓冲区大小
 };
 
 #endif //BUFFER_H
\ No newline at end of file
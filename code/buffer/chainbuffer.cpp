@@ -0,0 +1,279 @@
+#include "chainbuffer.h"
+
+// 构造函数: 不预先分配 slab. 先构造共享池, 使其晚于所有缓冲区 (包括单例中的) 析构
+ChainBuffer::ChainBuffer() : head_(0), tail_(nullptr), tailPos_(0), readable_(0), files_(0) {
+    SlabPool::Instance();
+}
+
+// 析构函数, 归还所有 slab
+ChainBuffer::~ChainBuffer() {
+    RetrieveAll();
+}
+
+// 当前 slab 中连续可写的字节数, 没有 slab 时为 0
+size_t ChainBuffer::WritableBytes() const {
+    return tail_ ? SlabPool::SLAB_SIZE - tailPos_ : 0;
+}
+
+// 确保有 len 字节连续的可写空间: 当前 slab 剩余的不够时换新的 slab (已写入的数据留在原来的 slab 中)
+void ChainBuffer::EnsureWriteable(size_t len) {
+    assert(len <= MAX_WRITABLE);
+    if(WritableBytes() < len) {
+        NewSlab_(SlabPool::Instance()->Alloc());
+    }
+}
+
+// 可写空间的起始位置
+char* ChainBuffer::BeginWrite() {
+    assert(tail_);
+    return tail_ + tailPos_;
+}
+
+// 写入可写空间后更新
+void ChainBuffer::HasWritten(size_t len) {
+    assert(len <= WritableBytes());
+    Commit_(len);
+}
+
+// 追加字符串
+void ChainBuffer::Append(const std::string& str) {
+    Append(str.data(), str.length());
+}
+
+// 追加二进制数据
+void ChainBuffer::Append(const void* data, size_t len) {
+    assert(data);
+    Append(static_cast<const char*>(data), len);
+}
+
+// 复制数据到 slab 中, 当前 slab 写满后换新的 slab 继续, 已有的数据不移动
+void ChainBuffer::Append(const char* str, size_t len) {
+    while(len > 0) {
+        if(WritableBytes() == 0) {
+            NewSlab_(SlabPool::Instance()->Alloc());
+        }
+        size_t n = std::min(len, WritableBytes());
+        memcpy(BeginWrite(), str, n);
+        Commit_(n);
+        str += n;
+        len -= n;
+    }
+}
+
+// 追加外部内存的引用
+void ChainBuffer::AppendRef(const char* data, size_t len, const void* tag) {
+    if(len == 0) {
+        return;
+    }
+    pieces_.push_back({ data, len, nullptr, -1, 0, tag, nullptr });
+    readable_ += len;
+}
+
+// 追加文件中的一段
+void ChainBuffer::AppendFile(int fd, off_t offset, size_t len, const void* tag) {
+    assert(fd >= 0);
+    if(len == 0) {
+        return;
+    }
+    pieces_.push_back({ nullptr, len, nullptr, fd, offset, tag, nullptr });
+    readable_ += len;
+    files_++;
+}
+
+// 用一个空的片段保持 owner, 取出它之前的数据时一起释放; 没有数据时直接释放
+void ChainBuffer::Hold(std::shared_ptr<const void> owner) {
+    if(!owner || readable_ == 0) {
+        return;
+    }
+    pieces_.push_back({ nullptr, 0, nullptr, -1, 0, nullptr, std::move(owner) });
+}
+
+// 整理开头的内存数据为 iovec, 跳过空的片段
+int ChainBuffer::PeekIov(struct iovec* iov, const void** tags, int maxIov) const {
+    int n = 0;
+    for(size_t i = head_; i < pieces_.size() && n < maxIov; i++) {
+        const Piece& piece = pieces_[i];
+        if(piece.fd >= 0) {
+            break;
+        }
+        if(piece.len == 0) {
+            continue;
+        }
+        iov[n].iov_base = const_cast<char*>(piece.data);
+        iov[n].iov_len = piece.len;
+        if(tags) { tags[n] = piece.tag; }
+        n++;
+    }
+    return n;
+}
+
+// 开头的文件片段 (取出数据后开头不会是空的片段)
+bool ChainBuffer::PeekFile(int* fd, off_t* offset, size_t* len, const void** tag) const {
+    if(head_ >= pieces_.size() || pieces_[head_].fd < 0) {
+        return false;
+    }
+    const Piece& piece = pieces_[head_];
+    *fd = piece.fd;
+    *offset = piece.offset;
+    *len = piece.len;
+    if(tag) { *tag = piece.tag; }
+    return true;
+}
+
+// 取出开头的 len 字节: 取完的片段 (以及紧随其后的空片段) 依次释放, 最后一个只移动位置
+void ChainBuffer::Retrieve(size_t len) {
+    assert(len <= readable_);
+    readable_ -= len;
+    while(head_ < pieces_.size()) {
+        Piece& piece = pieces_[head_];
+        if(piece.len > len) {
+            if(piece.fd >= 0) {
+                piece.offset += len;
+            } else {
+                piece.data += len;
+            }
+            piece.len -= len;
+            break;
+        }
+        len -= piece.len;
+        Release_(piece);
+        head_++;
+    }
+    if(head_ == pieces_.size()) {
+        RetrieveAll();                              // 全部取完, 当前 slab 也归还
+    } else if(head_ >= COMPACT_PIECES && head_ * 2 >= pieces_.size()) {
+        pieces_.erase(pieces_.begin(), pieces_.begin() + head_);
+        head_ = 0;
+    }
+}
+
+// 清空缓冲区, 释放所有片段和当前 slab
+void ChainBuffer::RetrieveAll() {
+    for(size_t i = head_; i < pieces_.size(); i++) {
+        Release_(pieces_[i]);
+    }
+    pieces_.clear();
+    head_ = 0;
+    readable_ = 0;
+    files_ = 0;
+    DropSlab_();
+}
+
+// 取出全部数据到一个字符串中
+std::string ChainBuffer::RetrieveAllToStr() {
+    std::string str;
+    str.reserve(readable_);
+    for(size_t i = head_; i < pieces_.size(); i++) {
+        assert(pieces_[i].fd < 0);
+        str.append(pieces_[i].data, pieces_[i].len);
+    }
+    RetrieveAll();
+    return str;
+}
+
+// 从 fd 读取数据: 当前 slab 的剩余空间和 READ_SLABS 个新的 slab 一起 readv, 没有用到的新 slab 直接归还
+ssize_t ChainBuffer::ReadFd(int fd, int* saveErrno) {
+    struct iovec iov[READ_SLABS + 1];
+    char* slabs[READ_SLABS];
+    int n = 0;
+    const size_t writable = WritableBytes();
+    if(writable > 0) {
+        iov[n].iov_base = BeginWrite();
+        iov[n++].iov_len = writable;
+    }
+    for(int i = 0; i < READ_SLABS; i++) {
+        slabs[i] = SlabPool::Instance()->Alloc();
+        iov[n].iov_base = slabs[i] + SLAB_HEAD;
+        iov[n++].iov_len = MAX_WRITABLE;
+    }
+    const ssize_t len = readv(fd, iov, n);
+    if(len < 0) {
+        *saveErrno = errno;
+    }
+    size_t left = len > 0 ? len : 0;
+    size_t n0 = std::min(left, writable);
+    Commit_(n0);
+    left -= n0;
+    for(int i = 0; i < READ_SLABS; i++) {
+        if(left > 0) {
+            NewSlab_(slabs[i]);
+            size_t k = std::min(left, MAX_WRITABLE);
+            Commit_(k);
+            left -= k;
+        } else {
+            SlabPool::Instance()->Free(slabs[i]);
+        }
+    }
+    return len;
+}
+
+// 写出开头的数据, 写出的部分从缓冲区中取出
+ssize_t ChainBuffer::WriteFd(int fd, int* saveErrno) {
+    int inFd;
+    off_t offset;
+    size_t fileLen;
+    ssize_t len;
+    if(PeekFile(&inFd, &offset, &fileLen, nullptr)) {
+        len = sendfile(fd, inFd, &offset, fileLen);
+    } else {
+        struct iovec iov[MAX_IOV];
+        len = writev(fd, iov, PeekIov(iov, nullptr, MAX_IOV));
+    }
+    if(len < 0) {
+        *saveErrno = errno;
+        return len;
+    }
+    Retrieve(len);
+    return len;
+}
+
+// 当前 slab 中新写入的数据紧接在最后一个片段之后时合并到该片段, 否则作为新的片段 (引用 slab 一次)
+void ChainBuffer::Commit_(size_t len) {
+    if(len == 0) {
+        return;
+    }
+    const char* start = tail_ + tailPos_;
+    if(!pieces_.empty() && pieces_.back().slab == tail_ && pieces_.back().data + pieces_.back().len == start) {
+        pieces_.back().len += len;
+    } else {
+        pieces_.push_back({ start, len, tail_, -1, 0, nullptr, nullptr });
+        Refs_(tail_)++;
+    }
+    tailPos_ += len;
+    readable_ += len;
+}
+
+// 换用新的 slab 追加数据, 原来的 slab 在其中的片段取完后归还
+void ChainBuffer::NewSlab_(char* slab) {
+    DropSlab_();
+    tail_ = slab;
+    Refs_(tail_) = 1;
+    tailPos_ = SLAB_HEAD;
+}
+
+// 不再向当前 slab 追加
+void ChainBuffer::DropSlab_() {
+    if(tail_) {
+        Unref_(tail_);
+        tail_ = nullptr;
+    }
+}
+
+// 释放取完的片段: slab 减少一次引用, 释放保持的对象
+void ChainBuffer::Release_(Piece& piece) {
+    if(piece.slab) {
+        Unref_(piece.slab);
+        piece.slab = nullptr;
+    }
+    if(piece.fd >= 0) {
+        files_--;
+    }
+    piece.owner.reset();
+}
+
+// 减少 slab 的引用计数, 为 0 时归还共享池
+void ChainBuffer::Unref_(char* slab) {
+    if(--Refs_(slab) == 0) {
+        SlabPool::Instance()->Free(slab);
+    }
+}
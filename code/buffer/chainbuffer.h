@@ -0,0 +1,104 @@
+#ifndef CHAIN_BUFFER_H
+#define CHAIN_BUFFER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <unistd.h>                                 // read, write
+#include <sys/uio.h>                                // readv, writev
+#include <sys/sendfile.h>                           // sendfile
+#include <assert.h>
+
+#include "slabpool.h"
+
+// 链式缓冲区: 数据按顺序存放在一串片段中, 片段可以是
+//   1. 共享池中的 slab: 追加的数据复制到这里, 写满后换新的 slab, 已有的数据从不移动或扩容复制;
+//   2. 外部内存的引用 (如映射的文件内容、缓存的响应头块), 追加时不复制;
+//   3. 文件中的一段, 发送时由内核从页缓存直接发送 (sendfile).
+// 可读的数据直接整理为 iovec 用于 writev/sendmsg, ReadFd 用 readv 直接读入 slab; 取出数据时释放已取完的 slab,
+// 全部取完后不再占用 slab. 与 Buffer 相同, 同一时刻只由一个线程使用
+class ChainBuffer {
+public:
+    ChainBuffer();
+    ~ChainBuffer();
+    ChainBuffer(const ChainBuffer&) = delete;
+    ChainBuffer& operator=(const ChainBuffer&) = delete;
+
+    // 可读的字节数 (包括引用的外部内存和文件片段)
+    size_t ReadableBytes() const { return readable_; }
+    // 是否有未取完的文件片段
+    bool HasFile() const { return files_ > 0; }
+    // 当前 slab 中连续可写的字节数
+    size_t WritableBytes() const;
+    // 确保当前 slab 中有 len 字节连续的可写空间 (不超过 MAX_WRITABLE), 不够时换新的 slab
+    void EnsureWriteable(size_t len);
+    // 可写空间的起始位置
+    char* BeginWrite();
+    // 写入 len 字节到可写空间后调用
+    void HasWritten(size_t len);
+
+    // 复制数据到 slab 中
+    void Append(const std::string& str);
+    void Append(const char* str, size_t len);
+    void Append(const void* data, size_t len);
+    // 追加外部内存的引用, 不复制; 调用者保证取出之前内存有效 (可以用 Hold 保持其所有者). tag 由调用者自定义
+    void AppendRef(const char* data, size_t len, const void* tag = nullptr);
+    // 追加文件 fd 中 [offset, offset + len) 的一段, 调用者保证取出之前文件保持打开
+    void AppendFile(int fd, off_t offset, size_t len, const void* tag = nullptr);
+    // 保持 owner 直到此前追加的数据全部取出 (如外部引用所在的缓存条目)
+    void Hold(std::shared_ptr<const void> owner);
+
+    // 从开头起连续的内存数据整理为 iovec (遇到文件片段时停止), 返回 iovec 的个数; tags 不为空时同时给出各自的标记
+    int PeekIov(struct iovec* iov, const void** tags, int maxIov) const;
+    // 开头是文件片段时返回 true, 并给出文件、当前偏移、剩余长度和标记
+    bool PeekFile(int* fd, off_t* offset, size_t* len, const void** tag) const;
+    // 取出开头的 len 字节, 释放已取完的 slab 和外部引用
+    void Retrieve(size_t len);
+    // 清空缓冲区, 释放所有 slab
+    void RetrieveAll();
+    // 取出全部数据 (不能有文件片段) 到一个字符串中
+    std::string RetrieveAllToStr();
+
+    // 从 fd 读取数据到 slab 中 (当前 slab 的剩余空间和几个新的 slab 一次 readv)
+    ssize_t ReadFd(int fd, int* Errno);
+    // 写出开头的数据: 文件片段用 sendfile, 否则一次 writev 到下一个文件片段之前
+    ssize_t WriteFd(int fd, int* Errno);
+
+    static constexpr size_t SLAB_HEAD = sizeof(size_t);                         // slab 开头保存引用计数
+    static constexpr size_t MAX_WRITABLE = SlabPool::SLAB_SIZE - SLAB_HEAD;     // 一个 slab 中可以存放的字节数
+
+private:
+    // 一个片段
+    struct Piece {
+        const char* data;                           // 数据的当前位置, 文件片段为 nullptr
+        size_t len;                                 // 剩余的字节数
+        char* slab;                                 // 数据所在的 slab, 外部引用和文件片段为 nullptr
+        int fd;                                     // 文件片段的文件描述符, 否则为 -1
+        off_t offset;                               // 文件片段的当前偏移
+        const void* tag;                            // 追加时给出的标记
+        std::shared_ptr<const void> owner;          // 取出此前的数据之后才释放的对象 (Hold)
+    };
+
+    void Commit_(size_t len);                       // 把当前 slab 中新写入的 len 字节加入片段 (与上一个片段相邻时合并)
+    void NewSlab_(char* slab);                      // 换用新的 slab 追加数据
+    void DropSlab_();                               // 不再向当前 slab 追加
+    void Release_(Piece& piece);                    // 释放取完的片段
+    static size_t& Refs_(char* slab) {              // slab 的引用计数: 正在追加的 slab 和其中的每个片段各算一次
+        return *reinterpret_cast<size_t*>(slab);
+    }
+    static void Unref_(char* slab);                 // 减少引用计数, 为 0 时归还共享池
+
+    std::vector<Piece> pieces_;                     // 片段, [head_, size) 为未取完的
+    size_t head_;                                   // 第一个未取完的片段
+    char* tail_;                                    // 正在追加数据的 slab, 没有时为 nullptr
+    size_t tailPos_;                                // tail_ 中已使用的字节数 (包括开头的引用计数)
+    size_t readable_;                               // 可读的字节数
+    size_t files_;                                  // 未取完的文件片段数
+
+    static constexpr int READ_SLABS = 4;            // ReadFd 一次最多读入的新 slab 数
+    static constexpr int MAX_IOV = 64;              // WriteFd 一次最多写出的 iovec 数
+    static constexpr size_t COMPACT_PIECES = 64;    // 已取完的片段超过该数目 (且过半) 时从数组中移除
+};
+
+#endif // CHAIN_BUFFER_H
@@ -0,0 +1,70 @@
+#include "slabpool.h"
+
+// 获取单例对象
+SlabPool* SlabPool::Instance() {
+    static SlabPool inst;
+    return &inst;
+}
+
+// 析构函数: 只释放全局空闲链表中的 slab, 仍在使用的由使用者归还
+SlabPool::~SlabPool() {
+    for(char* slab : free_) {
+        delete[] slab;
+    }
+}
+
+// 当前线程的缓存
+SlabPool::LocalCache& SlabPool::Local_() {
+    thread_local LocalCache cache;
+    return cache;
+}
+
+// 线程退出时把缓存的 slab 全部归还
+SlabPool::LocalCache::~LocalCache() {
+    SlabPool::Instance()->Drain_(slabs, 0);
+}
+
+// 分配一个 slab: 先从线程缓存中取, 为空时从全局空闲链表取一批, 都没有时新分配
+char* SlabPool::Alloc() {
+    std::vector<char*>& local = Local_().slabs;
+    if(local.empty()) {
+        Refill_(local);
+        if(local.empty()) {
+            return new char[SLAB_SIZE];
+        }
+    }
+    char* slab = local.back();
+    local.pop_back();
+    return slab;
+}
+
+// 归还一个 slab 到线程缓存, 缓存超过两批时归还一批到全局空闲链表
+void SlabPool::Free(char* slab) {
+    assert(slab);
+    std::vector<char*>& local = Local_().slabs;
+    local.push_back(slab);
+    if(local.size() > 2 * BATCH) {
+        Drain_(local, BATCH);
+    }
+}
+
+// 从全局空闲链表取一批
+void SlabPool::Refill_(std::vector<char*>& local) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    size_t n = std::min(BATCH, free_.size());
+    local.insert(local.end(), free_.end() - n, free_.end());
+    free_.resize(free_.size() - n);
+}
+
+// 线程缓存只保留 keep 个, 其余归还到全局空闲链表, 链表已满时直接释放
+void SlabPool::Drain_(std::vector<char*>& local, size_t keep) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    while(local.size() > keep) {
+        if(free_.size() < MAX_FREE) {
+            free_.push_back(local.back());
+        } else {
+            delete[] local.back();
+        }
+        local.pop_back();
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef SLAB_POOL_H
+#define SLAB_POOL_H
+
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <assert.h>
+
+// 固定大小内存块 (slab) 的共享池, 链式缓冲区 (ChainBuffer) 的数据都存放在 slab 中.
+// 每个线程缓存一批空闲的 slab, 分配和释放通常不需要加锁; 线程缓存为空或过多时与全局空闲链表成批交换
+class SlabPool {
+public:
+    static constexpr size_t SLAB_SIZE = 16 * 1024;  // 每个 slab 的大小
+
+    static SlabPool* Instance();                    // 获取单例对象
+    char* Alloc();                                  // 分配一个 slab (内存不初始化)
+    void Free(char* slab);                          // 归还一个 slab
+
+private:
+    SlabPool() = default;
+    ~SlabPool();                                    // 释放全局空闲链表中的 slab
+
+    // 线程的空闲 slab 缓存, 线程退出时归还到全局空闲链表
+    struct LocalCache {
+        ~LocalCache();
+        std::vector<char*> slabs;
+    };
+    static LocalCache& Local_();                     // 当前线程的缓存
+    void Refill_(std::vector<char*>& local);        // 从全局空闲链表取一批到线程缓存
+    void Drain_(std::vector<char*>& local, size_t keep);    // 线程缓存只保留 keep 个, 其余归还
+
+    std::vector<char*> free_;                       // 全局空闲链表
+    std::mutex mtx_;                                // 保护 free_
+
+    static constexpr size_t BATCH = 16;             // 线程缓存与全局空闲链表每次交换的个数
+    static constexpr size_t MAX_FREE = 1024;        // 全局空闲链表的上限 (16MB), 超出的直接释放
+};
+
+#endif // SLAB_POOL_H
@@ -0,0 +1,116 @@
+#include "assetstore.h"
+#include <dirent.h>                                 // opendir, readdir
+#include <chrono>
+using namespace std;
+
+// 构造函数
+AssetStore::AssetStore() {
+    arena_ = nullptr;
+    arenaLen_ = 0;
+}
+
+// 析构函数
+AssetStore::~AssetStore() {
+    if(arena_) { munmap(arena_, arenaLen_); }
+}
+
+// 获取单例对象
+AssetStore* AssetStore::Instance() {
+    static AssetStore store;
+    return &store;
+}
+
+// 预加载资源文件: 先遍历得到总大小, 一次分配整块内存, 再逐个读入
+void AssetStore::Load(const string& srcDir, size_t maxFileSize, size_t maxTotal, bool lock) {
+    assert(!arena_);
+    auto start = chrono::steady_clock::now();
+    string root = srcDir;
+    while(!root.empty() && root.back() == '/') { root.pop_back(); }
+    unordered_map<string, size_t> files;
+    Collect_(root, "/", maxFileSize, &files);
+    size_t total = 0;
+    for(auto it = files.begin(); it != files.end(); ) {
+        size_t need = (it->second + ALIGN - 1) / ALIGN * ALIGN;
+        if(total + need > maxTotal) {               // 超出总大小上限的文件走普通路径
+            it = files.erase(it);
+            continue;
+        }
+        total += need;
+        ++it;
+    }
+    if(total == 0) { return; }
+    // 优先使用预留的大页 (hugetlbfs), 没有时使用普通页并建议内核合并为透明大页
+    arenaLen_ = (total + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+    const char* pages = "hugetlb";
+    void* mem = mmap(nullptr, arenaLen_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if(mem == MAP_FAILED) {
+        mem = mmap(nullptr, arenaLen_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(mem == MAP_FAILED) {
+            LOG_WARN("AssetStore: cannot allocate %zu bytes (errno %d), preload disabled", arenaLen_, errno);
+            arenaLen_ = 0;
+            return;
+        }
+        pages = madvise(mem, arenaLen_, MADV_HUGEPAGE) == 0 ? "thp" : "4k";
+    }
+    arena_ = static_cast<char*>(mem);
+    // 读入文件, 记录加载时的 inode 和修改时间, 用于判断文件之后是否变化
+    size_t offset = 0, loaded = 0;
+    for(const auto& file : files) {
+        int fd = open((root + file.first).c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0) { continue; }
+        struct stat st;
+        size_t len = 0;
+        if(fstat(fd, &st) == 0 && size_t(st.st_size) == file.second) {
+            while(len < file.second) {
+                ssize_t n = read(fd, arena_ + offset + len, file.second - len);
+                if(n <= 0) { break; }
+                len += n;
+            }
+        }
+        close(fd);
+        if(len != file.second) { continue; }       // 加载期间文件被修改, 走普通路径
+        index_[file.first] = { offset, len, st.st_ino, st.st_mtim };
+        offset += (len + ALIGN - 1) / ALIGN * ALIGN;
+        loaded += len;
+    }
+    mprotect(arena_, arenaLen_, PROT_READ);         // 加载完成后只读
+    const char* locked = "off";
+    if(lock) {
+        locked = mlock(arena_, arenaLen_) == 0 ? "on" : "failed (RLIMIT_MEMLOCK?)";
+    }
+    long ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+    LOG_INFO("AssetStore: %zu files, %zu KB in %zu KB arena, pages %s, mlock %s, %ld ms",
+             index_.size(), loaded >> 10, arenaLen_ >> 10, pages, locked, ms);
+}
+
+// 文件未变化时返回预加载的内容
+const char* AssetStore::Find(const string& path, const struct stat& st) const {
+    if(index_.empty()) { return nullptr; }
+    auto it = index_.find(path);
+    if(it == index_.end()) { return nullptr; }
+    const Asset& asset = it->second;
+    if(asset.ino != st.st_ino || asset.len != size_t(st.st_size) ||
+       asset.mtime.tv_sec != st.st_mtim.tv_sec || asset.mtime.tv_nsec != st.st_mtim.tv_nsec) {
+        return nullptr;
+    }
+    return arena_ + asset.offset;
+}
+
+// 递归遍历目录, dir 是相对资源目录的路径, 以 '/' 结尾
+void AssetStore::Collect_(const string& root, const string& dir, size_t maxFileSize,
+                          unordered_map<string, size_t>* files) const {
+    DIR* dp = opendir((root + dir).c_str());
+    if(!dp) { return; }
+    while(struct dirent* ent = readdir(dp)) {
+        string name = ent->d_name;
+        if(name == "." || name == "..") { continue; }
+        struct stat st;
+        if(stat((root + dir + name).c_str(), &st) < 0) { continue; }
+        if(S_ISDIR(st.st_mode)) {
+            Collect_(root, dir + name + "/", maxFileSize, files);
+        } else if(S_ISREG(st.st_mode) && (st.st_mode & S_IROTH) && st.st_size > 0 && size_t(st.st_size) <= maxFileSize) {
+            (*files)[dir + name] = st.st_size;
+        }
+    }
+    closedir(dp);
+}
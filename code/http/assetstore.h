@@ -0,0 +1,47 @@
+#ifndef ASSET_STORE_H
+#define ASSET_STORE_H
+
+#include <string>
+#include <unordered_map>
+#include <fcntl.h>                                  // open
+#include <unistd.h>                                 // read, close
+#include <sys/stat.h>                               // stat
+#include <sys/mman.h>                               // mmap, madvise, mlock
+
+#include "../log/log.h"
+
+// 启动时预加载的静态资源: 遍历资源目录, 把不超过大小上限的文件读入一块连续的内存 (尽量使用大页),
+// 可选 mlock 常驻内存, 避免部署后页缓存为空时的磁盘读取. 加载完成后只读, 各线程无需加锁.
+// FileCache 加载文件时先查找这里, 文件未变化 (inode、修改时间、大小相同) 时直接引用预加载的内容
+class AssetStore {
+public:
+    static AssetStore* Instance();                  // 获取单例对象
+    // 加载 srcDir 下不超过 maxFileSize 的文件, 总大小不超过 maxTotal; lock 为 true 时 mlock 整块内存
+    void Load(const std::string& srcDir, size_t maxFileSize, size_t maxTotal, bool lock);
+    // 请求路径 (以 '/' 开头) 对应的预加载内容, 没有或文件已经变化时返回 nullptr
+    const char* Find(const std::string& path, const struct stat& st) const;
+
+private:
+    AssetStore();                                   // 构造函数
+    ~AssetStore();                                  // 析构函数
+
+    // 一个预加载的文件
+    struct Asset {
+        size_t offset;                              // 在 arena_ 中的偏移
+        size_t len;                                 // 文件大小
+        ino_t ino;                                  // 加载时的 inode
+        struct timespec mtime;                      // 加载时的修改时间
+    };
+    // 遍历目录, 收集要加载的文件 (相对路径和大小)
+    void Collect_(const std::string& root, const std::string& dir, size_t maxFileSize,
+                  std::unordered_map<std::string, size_t>* files) const;
+
+    std::unordered_map<std::string, Asset> index_;  // 请求路径到文件的索引
+    char* arena_;                                   // 存放所有文件内容的连续内存
+    size_t arenaLen_;                               // arena_ 的长度 (按大页对齐)
+
+    static const size_t HUGE_PAGE = 2 << 20;        // 大页大小
+    static const size_t ALIGN = 64;                 // 每个文件按缓存行对齐
+};
+
+#endif // ASSET_STORE_H
@@ -0,0 +1,381 @@
+#include "filecache.h"
+#include <dirent.h>                                 // opendir, readdir
+#include <poll.h>                                   // poll
+#include <sys/inotify.h>                            // inotify
+#include <sys/eventfd.h>                            // eventfd
+#include <sys/syscall.h>                            // syscall
+#include <time.h>                                   // clock_gettime
+#include <vector>
+using namespace std;
+
+// 监视的事件: 文件内容、权限/修改时间的变化, 以及文件的创建、删除和移动
+static const uint32_t WATCH_MASK = IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+
+// cachestat (Linux 6.5): 统计文件一段内容在页缓存中的页数, 不需要映射文件. 较旧的头文件没有定义
+#ifndef __NR_cachestat
+#define __NR_cachestat 451
+#endif
+struct CacheStatRange { uint64_t off, len; };
+struct CacheStat { uint64_t nrCache, nrDirty, nrWriteback, nrEvicted, nrRecentlyEvicted; };
+
+static const size_t PAGE_SIZE_ = sysconf(_SC_PAGESIZE);
+
+// 单调时钟的毫秒数 (低精度时钟, 不需要系统调用)
+static int64_t NowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return int64_t(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+// 释放条目持有的映射和文件描述符
+FileCache::Entry::~Entry() {
+    if(mapLen > 0) { munmap(const_cast<char*>(data), mapLen); }
+    if(fd >= 0) { close(fd); }
+}
+
+// 构造函数
+FileCache::FileCache() {
+    memBudget_ = maxEntries_ = sendfileMin_ = 0;
+    enabled_ = false;
+    memUsed_ = openFds_ = 0;
+    gen_ = 0;
+    inotifyFd_ = stopFd_ = -1;
+}
+
+// 析构函数: 停止事件处理线程, 释放缓存的条目
+FileCache::~FileCache() {
+    if(watcher_.joinable()) {
+        uint64_t one = 1;
+        ssize_t ret = write(stopFd_, &one, sizeof(one));
+        (void)ret;
+        watcher_.join();
+    }
+    if(inotifyFd_ >= 0) { close(inotifyFd_); }
+    if(stopFd_ >= 0) { close(stopFd_); }
+    Clear();
+}
+
+// 获取单例对象
+FileCache* FileCache::Instance() {
+    static FileCache cache;
+    return &cache;
+}
+
+// 初始化缓存并开始监视资源目录
+void FileCache::Init(const string& srcDir, size_t memBudget, size_t maxEntries, size_t sendfileMin) {
+    assert(!watcher_.joinable());
+    srcDir_ = srcDir;
+    while(!srcDir_.empty() && srcDir_.back() == '/') { srcDir_.pop_back(); }
+    memBudget_ = memBudget;
+    maxEntries_ = maxEntries;
+    sendfileMin_ = sendfileMin;
+    if(memBudget_ == 0 || maxEntries_ == 0) {
+        return;                                     // 不缓存, 每次请求都访问文件系统
+    }
+    // 没有 inotify 就无法得知文件的变化, 缓存的内容可能过期, 此时不启用缓存
+    inotifyFd_ = inotify_init1(IN_CLOEXEC);
+    stopFd_ = eventfd(0, EFD_CLOEXEC);
+    if(inotifyFd_ < 0 || stopFd_ < 0) {
+        LOG_WARN("FileCache: inotify/eventfd unavailable (errno %d), cache disabled", errno);
+        return;
+    }
+    AddWatch_("/");
+    if(watches_.empty()) {
+        LOG_WARN("FileCache: cannot watch %s, cache disabled", srcDir_.c_str());
+        return;
+    }
+    enabled_ = true;
+    watcher_ = thread(&FileCache::WatchLoop_, this);
+}
+
+// 获取请求路径对应的文件. 命中时不访问文件系统;
+// 未命中时在锁外读取文件, 期间有文件变化 (gen_ 改变) 则不放入缓存, 避免缓存过期的内容
+FileCache::EntryPtr FileCache::Get(const string& path) {
+    if(!enabled_ || !Cacheable_(path)) {
+        return Load_(path);
+    }
+    uint64_t gen;
+    {
+        lock_guard<mutex> locker(mtx_);
+        auto it = map_.find(path);
+        if(it != map_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second);    // 移到链表头部
+            return it->second->entry;
+        }
+        gen = gen_;
+    }
+    EntryPtr entry = Load_(path);
+    // 打开或映射失败的文件不缓存, 下次重试; 超过内存上限的映射也不缓存
+    bool readable = entry->exists && S_ISREG(entry->st.st_mode) && (entry->st.st_mode & S_IROTH) && entry->st.st_size > 0;
+    if((readable && entry->fd < 0 && !entry->data) || entry->mapLen > memBudget_) {
+        return entry;
+    }
+    lock_guard<mutex> locker(mtx_);
+    if(gen != gen_) {
+        return entry;
+    }
+    auto it = map_.find(path);
+    if(it != map_.end()) {                          // 其他线程已经加载
+        return it->second->entry;
+    }
+    lru_.push_front({ path, entry });
+    map_[path] = lru_.begin();
+    memUsed_ += entry->mapLen;
+    if(entry->fd >= 0) { openFds_++; }
+    // 按最近最少使用的顺序淘汰, 正在发送的连接仍持有被淘汰的条目, 发送完成后才释放
+    while(memUsed_ > memBudget_ || lru_.size() > maxEntries_ || openFds_ > MAX_OPEN_FDS) {
+        Erase_(prev(lru_.end()));
+    }
+    return entry;
+}
+
+// 清空缓存
+void FileCache::Clear() {
+    lock_guard<mutex> locker(mtx_);
+    lru_.clear();
+    map_.clear();
+    memUsed_ = openFds_ = 0;
+    gen_++;
+}
+
+// 读取文件状态, 可读的普通文件打开后较大的保持打开, 较小的整个映射到内存 (已预加载的除外).
+// 超过 MAX_MAP_SIZE 的文件即使配置为总是映射也用 sendfile 分批发送, 不整个映射
+FileCache::EntryPtr FileCache::Load_(const string& path) const {
+    shared_ptr<Entry> entry = make_shared<Entry>();
+    entry->fd = -1;
+    entry->data = nullptr;
+    entry->mapLen = 0;
+    string file = srcDir_ + path;
+    entry->exists = stat(file.c_str(), &entry->st) == 0;
+    if(!entry->exists) {
+        entry->st = { 0 };
+        return entry;
+    }
+    if(!S_ISREG(entry->st.st_mode) || !(entry->st.st_mode & S_IROTH) || entry->st.st_size == 0) {
+        return entry;
+    }
+    // 启动时预加载的文件没有变化时直接引用预加载的内容, 不再打开和映射
+    entry->data = AssetStore::Instance()->Find(path, entry->st);
+    if(entry->data) {
+        return entry;
+    }
+    int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        return entry;
+    }
+    LOG_DEBUG("file path %s", file.c_str());
+    size_t size = entry->st.st_size;
+    if((sendfileMin_ > 0 && size >= sendfileMin_) || size > MAX_MAP_SIZE) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);    // 按顺序发送, 加大预读窗口
+        entry->fd = fd;
+        return entry;
+    }
+    void* ret = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(ret != MAP_FAILED) {
+        entry->data = static_cast<const char*>(ret);
+        entry->mapLen = size;
+    }
+    return entry;
+}
+
+// 检查文件内容是否在内存中. 热点文件每次发送都检查会多一次系统调用,
+// 所以整个文件在 RESIDENT_HINT_MS 内确认过时直接认为仍在内存中
+bool FileCache::Resident(const Entry& entry, off_t off, size_t len) {
+    if(entry.mapLen == 0 && entry.fd < 0) {
+        return true;                                // 预加载的内容或在内存中生成的内容
+    }
+    bool whole = off == 0 && len >= size_t(entry.st.st_size);
+    int64_t now = NowMs();
+    if(whole && now - entry.residentAt.load(memory_order_relaxed) < RESIDENT_HINT_MS) {
+        return true;
+    }
+    bool resident = entry.mapLen > 0 ? MapResident_(entry.data + off, len) : FdResident_(entry.fd, off, len);
+    if(resident && whole) {
+        entry.residentAt.store(now, memory_order_relaxed);
+    }
+    return resident;
+}
+
+// 读入文件内容: 先提示内核一次提交整段的读取, 再逐页访问 (映射) 或读取 (sendfile 的文件) 等待完成
+void FileCache::Prefetch(const Entry& entry, off_t off, size_t len) {
+    if(entry.mapLen > 0) {
+        uintptr_t start = reinterpret_cast<uintptr_t>(entry.data + off) & ~(PAGE_SIZE_ - 1);
+        uintptr_t end = reinterpret_cast<uintptr_t>(entry.data + off + len);
+        madvise(reinterpret_cast<void*>(start), end - start, MADV_WILLNEED);
+        volatile char sink = 0;
+        for(uintptr_t p = start; p < end; p += PAGE_SIZE_) {
+            sink = sink + *reinterpret_cast<const volatile char*>(p);
+        }
+    } else if(entry.fd >= 0) {
+        posix_fadvise(entry.fd, off, len, POSIX_FADV_WILLNEED);
+        thread_local vector<char> buf(256 * 1024);
+        while(len > 0) {
+            ssize_t n = pread(entry.fd, buf.data(), min(len, buf.size()), off);
+            if(n <= 0) { break; }
+            off += n;
+            len -= n;
+        }
+    }
+}
+
+// 映射的内存是否都在页缓存中, 无法判断时按在内存中处理 (照常发送)
+bool FileCache::MapResident_(const char* addr, size_t len) {
+    uintptr_t start = reinterpret_cast<uintptr_t>(addr) & ~(PAGE_SIZE_ - 1);
+    uintptr_t end = reinterpret_cast<uintptr_t>(addr + len);
+    unsigned char vec[256];
+    while(start < end) {
+        size_t pages = min((end - start + PAGE_SIZE_ - 1) / PAGE_SIZE_, sizeof(vec));
+        if(mincore(reinterpret_cast<void*>(start), pages * PAGE_SIZE_, vec) < 0) {
+            return true;
+        }
+        for(size_t i = 0; i < pages; i++) {
+            if(!(vec[i] & 1)) { return false; }
+        }
+        start += pages * PAGE_SIZE_;
+    }
+    return true;
+}
+
+// 文件的一段是否都在页缓存中. 内核不支持 cachestat 时映射这一段再用 mincore 检查
+bool FileCache::FdResident_(int fd, off_t off, size_t len) {
+    static atomic<bool> noCachestat(false);
+    off_t first = off & ~off_t(PAGE_SIZE_ - 1);
+    size_t pages = (off + len - first + PAGE_SIZE_ - 1) / PAGE_SIZE_;
+    if(!noCachestat.load(memory_order_relaxed)) {
+        CacheStatRange range = { uint64_t(first), pages * PAGE_SIZE_ };
+        CacheStat cs;
+        if(syscall(__NR_cachestat, fd, &range, &cs, 0) == 0) {
+            return cs.nrCache >= pages;
+        }
+        if(errno != ENOSYS) { return true; }
+        noCachestat = true;
+    }
+    void* addr = mmap(nullptr, pages * PAGE_SIZE_, PROT_READ, MAP_SHARED, fd, first);
+    if(addr == MAP_FAILED) { return true; }
+    bool resident = MapResident_(static_cast<const char*>(addr), pages * PAGE_SIZE_);
+    munmap(addr, pages * PAGE_SIZE_);
+    return resident;
+}
+
+// 只缓存规范路径: inotify 事件中的文件名只能对应到规范路径, 含 "//"、"." 或 ".." 的路径无法失效
+bool FileCache::Cacheable_(const string& path) {
+    if(path.empty() || path[0] != '/') { return false; }
+    for(size_t i = 0; i < path.size(); i++) {
+        if(path[i] != '/') { continue; }
+        size_t end = path.find('/', i + 1);
+        size_t len = (end == string::npos ? path.size() : end) - i - 1;
+        if((len == 0 && end != string::npos) || (len == 1 && path[i + 1] == '.') ||
+           (len == 2 && path[i + 1] == '.' && path[i + 2] == '.')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 删除一个条目, 调用者持有锁
+void FileCache::Erase_(NodeIter it) {
+    memUsed_ -= it->entry->mapLen;
+    if(it->entry->fd >= 0) { openFds_--; }
+    map_.erase(it->path);
+    lru_.erase(it);
+}
+
+// 使路径的条目失效; 目录被创建、删除或移动时, 其下所有路径的条目也失效
+void FileCache::Invalidate_(const string& path, bool isDir) {
+    lock_guard<mutex> locker(mtx_);
+    gen_++;                                         // 正在加载的条目可能已过期, 不再放入缓存
+    auto it = map_.find(path);
+    if(it != map_.end()) {
+        Erase_(it->second);
+    }
+    if(isDir) {
+        string prefix = path + "/";
+        for(auto node = lru_.begin(); node != lru_.end(); ) {
+            auto next = std::next(node);
+            if(node->path.compare(0, prefix.size(), prefix) == 0) {
+                Erase_(node);
+            }
+            node = next;
+        }
+    }
+}
+
+// 监视目录及其所有子目录 (inotify 不会递归监视), dir 是相对资源目录的路径, 以 '/' 结尾
+void FileCache::AddWatch_(const string& dir) {
+    string path = srcDir_ + dir;
+    int wd = inotify_add_watch(inotifyFd_, path.c_str(), WATCH_MASK | IN_ONLYDIR);
+    if(wd < 0) {
+        LOG_WARN("FileCache: inotify_add_watch %s failed (errno %d)", path.c_str(), errno);
+        return;
+    }
+    watches_[wd] = dir;
+    DIR* dp = opendir(path.c_str());
+    if(!dp) { return; }
+    while(struct dirent* ent = readdir(dp)) {
+        string name = ent->d_name;
+        if(name == "." || name == "..") { continue; }
+        bool isDir = ent->d_type == DT_DIR;
+        if(ent->d_type == DT_UNKNOWN) {             // 部分文件系统不提供类型, 需要 stat
+            struct stat st;
+            isDir = stat((path + name).c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+        }
+        if(isDir) {
+            AddWatch_(dir + name + "/");
+        }
+    }
+    closedir(dp);
+}
+
+// inotify 事件处理线程: 使变化的文件对应的条目失效, 直到析构时通过 stopFd_ 通知退出
+void FileCache::WatchLoop_() {
+    alignas(struct inotify_event) char buf[4096];
+    struct pollfd fds[2] = { { inotifyFd_, POLLIN, 0 }, { stopFd_, POLLIN, 0 } };
+    while(true) {
+        if(poll(fds, 2, -1) < 0) {
+            if(errno == EINTR) { continue; }
+            break;
+        }
+        if(fds[1].revents) { break; }
+        ssize_t len = read(inotifyFd_, buf, sizeof(buf));
+        if(len <= 0) {
+            if(len < 0 && errno == EINTR) { continue; }
+            break;
+        }
+        for(char* p = buf; p < buf + len; ) {
+            const struct inotify_event* ev = reinterpret_cast<const struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + ev->len;
+            if(ev->mask & IN_Q_OVERFLOW) {          // 事件队列溢出, 丢失了部分事件, 只能清空缓存
+                LOG_WARN("FileCache: inotify queue overflow, cache cleared");
+                Clear();
+                continue;
+            }
+            auto watch = watches_.find(ev->wd);
+            if(watch == watches_.end()) { continue; }
+            if(ev->mask & IN_IGNORED) {             // 目录已被删除, 监视自动移除
+                watches_.erase(watch);
+                continue;
+            }
+            if(ev->len == 0) { continue; }
+            string path = watch->second + ev->name;
+            bool isDir = ev->mask & IN_ISDIR;
+            if(isDir && (ev->mask & IN_MOVED_FROM)) {
+                // 目录被移走: 移除其下的监视 (移动后的位置由 IN_MOVED_TO 重新监视)
+                string prefix = path + "/";
+                for(auto it = watches_.begin(); it != watches_.end(); ) {
+                    if(it->second.compare(0, prefix.size(), prefix) == 0) {
+                        inotify_rm_watch(inotifyFd_, it->first);
+                        it = watches_.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+            }
+            if(isDir && (ev->mask & (IN_CREATE | IN_MOVED_TO))) {
+                AddWatch_(path + "/");
+            }
+            LOG_DEBUG("FileCache: invalidate %s (mask 0x%x)", path.c_str(), ev->mask);
+            Invalidate_(path, isDir);
+        }
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include <string>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+#include <fcntl.h>                                  // open
+#include <unistd.h>                                 // close
+#include <sys/stat.h>                               // stat
+#include <sys/mman.h>                               // mmap, munmap
+
+#include "../log/log.h"
+#include "assetstore.h"
+
+// 进程内共享的静态文件缓存: 按请求路径缓存文件状态、打开的文件描述符和内存映射.
+// 条目由 shared_ptr 引用计数, 被淘汰或失效后由最后一个使用者 (正在发送的连接) 释放;
+// 文件不存在时缓存否定条目 (404). 资源目录的变化由 inotify 通知, 使对应的条目失效
+class FileCache {
+public:
+    // 缓存条目, 创建后不再修改, 可以在多个连接间共享 (只知道条目地址时可以由 shared_from_this 取得引用)
+    struct Entry : std::enable_shared_from_this<Entry> {
+        ~Entry();
+        bool exists;                                // 文件是否存在
+        struct stat st;                             // 文件状态
+        int fd;                                     // 较大的文件保持打开, 用 sendfile 发送; 否则为 -1
+        const char* data;                           // 较小的文件整个映射到内存 (或预加载的内容); 否则为 nullptr
+        size_t mapLen;                              // 映射的长度
+        std::string buf;                            // 在内存中生成的内容 (如即时压缩的结果), 此时 data 指向这里
+        mutable std::atomic<int64_t> residentAt{0}; // 最近一次确认整个文件在内存中的时间 (毫秒)
+
+        // 预先生成的响应头块 (状态行和不随响应变化的头部), 由使用者第一次需要时调用 build 生成
+        static const int HEAD_SLOTS = 6;
+        template<class F>
+        const std::string& Head(int slot, F build) const {
+            std::call_once(headOnce_[slot], [&] { heads_[slot] = build(); });
+            return heads_[slot];
+        }
+    private:
+        mutable std::once_flag headOnce_[HEAD_SLOTS];
+        mutable std::string heads_[HEAD_SLOTS];
+    };
+    typedef std::shared_ptr<const Entry> EntryPtr;
+
+    static FileCache* Instance();                   // 获取单例对象
+    // 初始化: 资源目录, 内存映射总大小上限 (0 表示不缓存), 条目数上限, 使用 sendfile 的文件大小阈值 (0 表示总是映射)
+    void Init(const std::string& srcDir, size_t memBudget, size_t maxEntries, size_t sendfileMin);
+    EntryPtr Get(const std::string& path);          // 获取请求路径 (以 '/' 开头) 对应的文件
+    void Clear();                                   // 清空缓存
+    bool IsEnabled() const { return enabled_; }     // 是否启用了缓存 (inotify 初始化失败时不缓存)
+    // 文件内容 [off, off + len) 是否都在内存中 (页缓存、预加载或生成的内容), 发送时不会阻塞在磁盘读取上
+    static bool Resident(const Entry& entry, off_t off, size_t len);
+    // 把文件内容 [off, off + len) 读入页缓存, 会阻塞在磁盘 I/O 上, 只在 I/O 线程中调用
+    static void Prefetch(const Entry& entry, off_t off, size_t len);
+
+private:
+    FileCache();                                    // 构造函数
+    ~FileCache();                                   // 析构函数
+
+    // 缓存链表的节点, 按最近使用的顺序排列
+    struct Node {
+        std::string path;
+        EntryPtr entry;
+    };
+    typedef std::list<Node>::iterator NodeIter;
+
+    EntryPtr Load_(const std::string& path) const;  // 读取文件状态并打开/映射文件
+    static bool Cacheable_(const std::string& path);  // 路径是否为规范形式 (inotify 事件只能对应规范路径)
+    void Erase_(NodeIter it);                       // 删除一个条目 (调用者持有锁)
+    void Invalidate_(const std::string& path, bool isDir);  // 使路径 (或目录下的所有路径) 的条目失效
+    void AddWatch_(const std::string& dir);         // 监视目录及其所有子目录
+    void WatchLoop_();                              // inotify 事件处理线程
+    static bool MapResident_(const char* addr, size_t len);     // 映射的内存是否都在页缓存中 (mincore)
+    static bool FdResident_(int fd, off_t off, size_t len);     // 文件的一段是否都在页缓存中 (cachestat)
+
+    std::string srcDir_;                            // 资源目录 (不带结尾的 '/')
+    size_t memBudget_;                              // 内存映射总大小上限
+    size_t maxEntries_;                             // 条目数上限
+    size_t sendfileMin_;                            // 文件不小于该字节数时不映射, 保持打开用 sendfile 发送
+    bool enabled_;                                  // 是否启用缓存
+
+    std::list<Node> lru_;                           // 缓存的条目, 最近使用的在前
+    std::unordered_map<std::string, NodeIter> map_; // 请求路径到条目的映射
+    size_t memUsed_;                                // 缓存中的内存映射总大小
+    size_t openFds_;                                // 缓存中保持打开的文件描述符数
+    uint64_t gen_;                                  // 每次失效时加一, 用于丢弃加载期间已经过期的条目
+    std::mutex mtx_;                                // 保护以上成员
+
+    int inotifyFd_;                                 // inotify 实例
+    int stopFd_;                                    // 通知事件处理线程退出的 eventfd
+    std::unordered_map<int, std::string> watches_;  // 监视描述符到目录 (相对资源目录, 以 '/' 结尾) 的映射
+    std::thread watcher_;                           // inotify 事件处理线程
+
+    static const size_t MAX_OPEN_FDS = 256;         // 缓存中保持打开的文件描述符上限
+    static const size_t MAX_MAP_SIZE = 16 << 20;    // 映射的文件大小上限, 更大的文件总是用 sendfile 发送
+    static const int64_t RESIDENT_HINT_MS = 1000;   // 整个文件在这段时间内确认过在内存中时不再检查
+};
+
+#endif // FILE_CACHE_H
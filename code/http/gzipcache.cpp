@@ -0,0 +1,215 @@
+#include "gzipcache.h"
+#include <chrono>
+using namespace std;
+
+// 构造函数
+GzipCache::GzipCache() {
+    minSize_ = maxSize_ = memBudget_ = memUsed_ = 0;
+    level_ = Z_DEFAULT_COMPRESSION;
+    hits_ = misses_ = pending_ = bytesIn_ = bytesOut_ = compressUs_ = 0;
+}
+
+// 获取单例对象
+GzipCache* GzipCache::Instance() {
+    static GzipCache cache;
+    return &cache;
+}
+
+// 初始化
+void GzipCache::Init(const string& srcDir, size_t minSize, size_t memBudget, int level) {
+    srcDir_ = srcDir;
+    minSize_ = memBudget > 0 ? minSize : 0;         // 没有缓存空间时不压缩, 否则每个请求都要重新压缩
+    memBudget_ = memBudget;
+    maxSize_ = memBudget / 4;
+    level_ = (level >= 1 && level <= 9) ? level : Z_DEFAULT_COMPRESSION;
+}
+
+// 设置执行压缩任务的线程池
+void GzipCache::SetExecutor(Executor executor) {
+    lock_guard<mutex> locker(mtx_);
+    executor_ = move(executor);
+}
+
+// 文件的压缩结果, 键中包含修改时间, 文件修改后的第一个请求重新压缩, 旧的结果随 LRU 淘汰
+FileCache::EntryPtr GzipCache::Get(const string& path, const FileCache::EntryPtr& file) {
+    size_t size = file->st.st_size;
+    if(!IsEnabled() || size < minSize_ || size > maxSize_ || (!file->data && file->fd < 0)) {
+        return nullptr;
+    }
+    string key = path + "|" + to_string(file->st.st_mtim.tv_sec * 1000000000LL + file->st.st_mtim.tv_nsec) + "|gzip";
+    // 压缩任务持有文件条目, 压缩完成前文件描述符和内容保持有效
+    return Lookup_(key, file->st, [this, path, file](string* out) { return CompressFile_(path, file, out); });
+}
+
+// 生成的内容的压缩结果 (内容复制到压缩任务中)
+FileCache::EntryPtr GzipCache::Get(const string& key, const string& body) {
+    if(!IsEnabled() || body.size() < minSize_ || body.size() > maxSize_) {
+        return nullptr;
+    }
+    struct stat st = { 0 };
+    st.st_size = body.size();
+    return Lookup_(key + "|gzip", st, [this, body](string* out) { return Compress_(body.data(), -1, body.size(), out); });
+}
+
+// 查找压缩结果, 没有时由第一个请求者提交压缩任务 (同一个键只压缩一次), 压缩完成前返回 nullptr, 请求发送原内容.
+// 没有设置线程池时在当前线程上压缩
+FileCache::EntryPtr GzipCache::Lookup_(const string& key, const struct stat& st, Reader read) {
+    shared_ptr<Slot> slot;
+    bool created = false;
+    Executor executor;
+    {
+        lock_guard<mutex> locker(mtx_);
+        auto it = map_.find(key);
+        if(it != map_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second);    // 移到链表头部
+            slot = it->second->slot;
+        } else {
+            slot = make_shared<Slot>();
+            lru_.push_front({ key, slot });
+            map_[key] = lru_.begin();
+            created = true;
+            executor = executor_;
+        }
+    }
+    if(slot->ready.load(memory_order_acquire)) {
+        if(++hits_ % STATS_INTERVAL == 0) {
+            LogStats();                             // 定期记录统计, 观察命中率
+        }
+        return slot->entry;
+    }
+    if(created && !executor) {
+        Fill_(key, st, slot, read);
+        return slot->entry;
+    }
+    if(created) {
+        executor([this, key, st, slot, read] { Fill_(key, st, slot, read); });
+    }
+    pending_++;
+    return nullptr;
+}
+
+// 压缩内容, 结果计入缓存大小后淘汰最久未使用的结果
+void GzipCache::Fill_(const string& key, const struct stat& st, const shared_ptr<Slot>& slot, const Reader& read) {
+    auto start = chrono::steady_clock::now();
+    string out;
+    // 压缩失败或没有变小时记录为 nullptr, 之后的请求直接发送原内容
+    if(read(&out) && out.size() < size_t(st.st_size)) {
+        shared_ptr<FileCache::Entry> entry = make_shared<FileCache::Entry>();
+        entry->exists = true;
+        entry->st = st;
+        entry->st.st_size = out.size();
+        entry->fd = -1;
+        entry->mapLen = 0;
+        entry->buf = move(out);
+        entry->buf.shrink_to_fit();
+        entry->data = entry->buf.data();
+        slot->entry = entry;
+    }
+    slot->ready.store(true, memory_order_release);
+    long us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+    size_t outLen = slot->entry ? slot->entry->st.st_size : st.st_size;
+    misses_++;
+    bytesIn_ += st.st_size;
+    bytesOut_ += outLen;
+    compressUs_ += us;
+    LOG_INFO("Gzip: %s %ld -> %zu bytes in %ld us (hits %lu, misses %lu)",
+             key.c_str(), (long)st.st_size, outLen, us, hits_.load(), misses_.load());
+    // 压缩期间已被淘汰的结果不再计入
+    lock_guard<mutex> locker(mtx_);
+    auto it = map_.find(key);
+    if(it != map_.end() && it->second->slot == slot) {
+        slot->cost = key.size() + (slot->entry ? slot->entry->buf.size() : 0);
+        memUsed_ += slot->cost;
+        while(memUsed_ > memBudget_ && lru_.size() > 1) {
+            Erase_(prev(lru_.end()));
+        }
+    }
+}
+
+// 压缩文件的内容: 大文件用保持打开的描述符 pread, 预加载的内容在匿名内存中直接压缩.
+// 映射的文件被截断后访问映射会触发 SIGBUS, 因此重新打开文件用 pread 读取, 文件已经变化 (不是键对应的版本) 时放弃
+bool GzipCache::CompressFile_(const string& path, const FileCache::EntryPtr& file, string* out) const {
+    if(file->mapLen == 0) {
+        return Compress_(file->data, file->fd, file->st.st_size, out);
+    }
+    int fd = open((srcDir_ + path).c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        return false;
+    }
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0 && st.st_size == file->st.st_size && st.st_mtim.tv_sec == file->st.st_mtim.tv_sec &&
+              st.st_mtim.tv_nsec == file->st.st_mtim.tv_nsec && Compress_(nullptr, fd, st.st_size, out);
+    close(fd);
+    return ok;
+}
+
+// gzip 格式流式压缩: 内存中的内容一次输入, 文件按块读取后输入, 输出按块扩展
+bool GzipCache::Compress_(const char* data, int fd, size_t len, string* out) const {
+    z_stream zs = {};
+    // windowBits 加 16 输出 gzip 头部和尾部
+    if(deflateInit2(&zs, level_, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    bool ok = true;
+    if(data) {
+        ok = Deflate_(&zs, data, len, true, out);
+    } else {
+        string chunk(CHUNK, '\0');
+        off_t offset = 0;
+        while(ok && size_t(offset) < len) {
+            ssize_t n = pread(fd, &chunk[0], min(CHUNK, len - offset), offset);
+            if(n <= 0) { ok = false; break; }       // 文件在压缩期间被截断
+            offset += n;
+            ok = Deflate_(&zs, chunk.data(), n, size_t(offset) == len, out);
+        }
+    }
+    deflateEnd(&zs);
+    return ok;
+}
+
+// 输入一段内容, 输出空间用完时扩展一块; finish 时写出剩余的数据和 gzip 尾部
+bool GzipCache::Deflate_(z_stream* zs, const char* data, size_t len, bool finish, string* out) const {
+    zs->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    zs->avail_in = len;
+    int ret;
+    do {
+        size_t used = out->size();
+        out->resize(used + CHUNK);
+        zs->next_out = reinterpret_cast<Bytef*>(&(*out)[used]);
+        zs->avail_out = CHUNK;
+        ret = deflate(zs, finish ? Z_FINISH : Z_NO_FLUSH);
+        out->resize(used + CHUNK - zs->avail_out);
+        if(ret == Z_STREAM_ERROR) { return false; }
+    } while(zs->avail_out == 0);
+    return !finish || ret == Z_STREAM_END;
+}
+
+// 删除一个结果, 调用者持有锁 (正在发送的连接仍持有压缩结果, 发送完成后才释放)
+void GzipCache::Erase_(NodeIter it) {
+    memUsed_ -= it->slot->cost;
+    map_.erase(it->key);
+    lru_.erase(it);
+}
+
+// 获取压缩统计
+GzipCache::Stats GzipCache::GetStats() {
+    Stats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.pending = pending_;
+    stats.bytesIn = bytesIn_;
+    stats.bytesOut = bytesOut_;
+    stats.compressUs = compressUs_;
+    lock_guard<mutex> locker(mtx_);
+    stats.memUsed = memUsed_;
+    return stats;
+}
+
+// 记录压缩统计
+void GzipCache::LogStats() {
+    Stats s = GetStats();
+    LOG_INFO("Gzip stats: %lu hits, %lu compressions (hit ratio %.1f%%), %lu sent uncompressed while compressing, "
+             "%lu -> %lu bytes, %.1f ms compressing, %zu bytes cached",
+             s.hits, s.misses, s.hits + s.misses ? 100.0 * s.hits / (s.hits + s.misses) : 0.0, s.pending,
+             s.bytesIn, s.bytesOut, s.compressUs / 1000.0, s.memUsed);
+}
@@ -0,0 +1,96 @@
+#ifndef GZIP_CACHE_H
+#define GZIP_CACHE_H
+
+#include <string>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include <zlib.h>
+
+#include "../log/log.h"
+#include "filecache.h"
+
+// 即时 gzip 压缩及其结果的缓存: 没有预压缩文件的文本响应在第一次请求时交给后台线程压缩,
+// 压缩完成前的请求发送原内容, 不阻塞在 zlib 和文件读取上. 结果按 (路径, 修改时间, 编码) 缓存,
+// 每个版本的文件只压缩一次. 缓存总大小有上限, 按 LRU 淘汰.
+// 压缩结果作为内存中的 FileCache::Entry 返回, 和文件一样由连接引用到发送完成
+class GzipCache {
+public:
+    typedef std::function<void(std::function<void()>)> Executor;  // 执行压缩任务的线程池
+
+    // 压缩统计
+    struct Stats {
+        unsigned long hits;                         // 命中次数
+        unsigned long misses;                       // 压缩次数
+        unsigned long pending;                      // 压缩完成前发送原内容的次数
+        unsigned long bytesIn;                      // 压缩前的总字节数
+        unsigned long bytesOut;                     // 压缩后的总字节数
+        unsigned long compressUs;                   // 压缩的总耗时 (微秒)
+        size_t memUsed;                             // 缓存的压缩结果总大小
+    };
+
+    static GzipCache* Instance();                   // 获取单例对象
+    // 初始化: 资源目录, 压缩的最小字节数 (0 表示不压缩), 缓存总大小上限, 压缩级别 (1-9)
+    void Init(const std::string& srcDir, size_t minSize, size_t memBudget, int level);
+    // 设置执行压缩任务的线程池, 为空时在调用者的线程上压缩 (第一个请求等待压缩完成)
+    void SetExecutor(Executor executor);
+    // 文件的压缩结果, 太小、太大、压缩后没有变小或还在压缩时返回 nullptr
+    FileCache::EntryPtr Get(const std::string& path, const FileCache::EntryPtr& file);
+    // 生成的内容 (如错误页面) 的压缩结果, key 需要唯一确定内容
+    FileCache::EntryPtr Get(const std::string& key, const std::string& body);
+    bool IsEnabled() const { return minSize_ > 0; } // 是否开启即时压缩
+    Stats GetStats();                               // 获取压缩统计
+    void LogStats();                                // 记录压缩次数、耗时和命中率
+
+private:
+    GzipCache();                                    // 构造函数
+    ~GzipCache() = default;                         // 析构函数
+
+    // 一个压缩结果, 第一个请求者提交压缩任务, 完成前到达的请求发送原内容
+    struct Slot {
+        std::atomic<bool> ready{false};             // 压缩是否完成, 完成后 entry 不再修改
+        FileCache::EntryPtr entry;                  // 压缩结果, 不值得压缩时为 nullptr
+        size_t cost = 0;                            // 计入缓存大小的字节数
+    };
+    struct Node {
+        std::string key;
+        std::shared_ptr<Slot> slot;
+    };
+    typedef std::list<Node>::iterator NodeIter;
+
+    typedef std::function<bool(std::string*)> Reader;  // 压缩内容, 结果追加到参数中
+
+    FileCache::EntryPtr Lookup_(const std::string& key, const struct stat& st, Reader read);   // 查找或提交压缩任务
+    void Fill_(const std::string& key, const struct stat& st, const std::shared_ptr<Slot>& slot, const Reader& read);  // 压缩并计入缓存
+    bool CompressFile_(const std::string& path, const FileCache::EntryPtr& file, std::string* out) const;  // 压缩文件的内容
+    bool Compress_(const char* data, int fd, size_t len, std::string* out) const;  // 流式压缩内存中或文件中的内容
+    bool Deflate_(z_stream* zs, const char* data, size_t len, bool finish, std::string* out) const;
+    void Erase_(NodeIter it);                       // 删除一个结果 (调用者持有锁)
+
+    std::string srcDir_;                            // 资源目录 (重新打开映射的文件时使用)
+    size_t minSize_;                                // 压缩的最小字节数
+    size_t maxSize_;                                // 压缩的最大字节数 (缓存上限的 1/4)
+    size_t memBudget_;                              // 缓存总大小上限
+    int level_;                                     // 压缩级别
+
+    std::list<Node> lru_;                           // 压缩结果, 最近使用的在前
+    std::unordered_map<std::string, NodeIter> map_; // 键到结果的映射
+    size_t memUsed_;                                // 缓存的压缩结果总大小
+    Executor executor_;                             // 执行压缩任务的线程池
+    std::mutex mtx_;                                // 保护以上成员
+
+    std::atomic<unsigned long> hits_;               // 命中次数
+    std::atomic<unsigned long> misses_;             // 压缩次数
+    std::atomic<unsigned long> pending_;            // 压缩完成前发送原内容的次数
+    std::atomic<unsigned long> bytesIn_;            // 压缩前的总字节数
+    std::atomic<unsigned long> bytesOut_;           // 压缩后的总字节数
+    std::atomic<unsigned long> compressUs_;         // 压缩的总耗时 (微秒)
+
+    static constexpr size_t CHUNK = 64 * 1024;      // 从文件读取和输出扩展的块大小
+    static constexpr unsigned long STATS_INTERVAL = 100000;  // 每命中这么多次记录一次统计
+};
+
+#endif // GZIP_CACHE_H
@@ -0,0 +1,131 @@
+#include "headertable.h"
+#include <cstring>
+
+namespace {
+// 常用头部字段名 (小写), 顺序与 HeaderTable::HEADER 一致
+constexpr std::string_view KNOWN_HEADERS[] = {
+    "host", "connection", "content-type", "content-length", "transfer-encoding",
+    "accept-encoding", "if-none-match", "if-modified-since", "range", "if-range",
+};
+static_assert(sizeof(KNOWN_HEADERS) / sizeof(KNOWN_HEADERS[0]) == HeaderTable::HDR_COUNT,
+              "KNOWN_HEADERS must match HeaderTable::HEADER");
+
+constexpr int HASH_BITS = 5;                        // 哈希表 32 个槽位
+
+constexpr char Lower(char ch) {
+    return (ch >= 'A' && ch <= 'Z') ? ch - 'A' + 'a' : ch;
+}
+
+// 由长度和首尾两个字符计算哈希, 乘法哈希取高位; 字符 | 0x20 使大小写字母得到相同的哈希
+constexpr uint32_t HeaderHash(const char* name, size_t len, uint32_t seed) {
+    uint32_t key = (static_cast<uint32_t>(len) << 16) | ((static_cast<uint8_t>(name[0]) | 0x20) << 8)
+                    | (static_cast<uint8_t>(name[len - 1]) | 0x20);
+    return (key * seed) >> (32 - HASH_BITS);
+}
+
+// 编译期搜索使常用字段互不冲突的乘数
+constexpr bool IsPerfectSeed(uint32_t seed) {
+    bool used[1 << HASH_BITS] = {};
+    for(std::string_view name : KNOWN_HEADERS) {
+        uint32_t h = HeaderHash(name.data(), name.size(), seed);
+        if(used[h]) { return false; }
+        used[h] = true;
+    }
+    return true;
+}
+
+constexpr uint32_t FindSeed() {
+    for(uint32_t seed = 0x9E3779B1u; seed < 0x9E3779B1u + 20000; seed += 2) {
+        if(IsPerfectSeed(seed)) { return seed; }
+    }
+    return 0;
+}
+
+constexpr uint32_t HEADER_SEED = FindSeed();
+static_assert(HEADER_SEED != 0, "no perfect hash seed for KNOWN_HEADERS");
+
+// 槽位到常用字段编号的映射, 空槽位为 -1
+struct HeaderSlots {
+    int8_t id[1 << HASH_BITS];
+    constexpr HeaderSlots() : id() {
+        for(int i = 0; i < (1 << HASH_BITS); i++) { id[i] = -1; }
+        for(int i = 0; i < HeaderTable::HDR_COUNT; i++) {
+            id[HeaderHash(KNOWN_HEADERS[i].data(), KNOWN_HEADERS[i].size(), HEADER_SEED)] = i;
+        }
+    }
+};
+constexpr HeaderSlots HEADER_SLOTS;
+
+// 比较头部名称与小写的常用字段名, 每次比较 8 个字节.
+// 名称已校验为 token, 其中只有字母在 | 0x20 后会变成小写字母, '-' 保持不变, 因此不会误判
+bool MatchKnownName(std::string_view key, std::string_view lowerName) {
+    if(key.size() != lowerName.size()) { return false; }
+    const uint64_t CASE_BITS = 0x2020202020202020ULL;
+    size_t i = 0;
+    for(; i + 8 <= key.size(); i += 8) {
+        uint64_t a, b;
+        memcpy(&a, key.data() + i, 8);
+        memcpy(&b, lowerName.data() + i, 8);
+        if((a | CASE_BITS) != b) { return false; }
+    }
+    for(; i < key.size(); i++) {
+        if((key[i] | 0x20) != lowerName[i]) { return false; }
+    }
+    return true;
+}
+}
+
+// 清空字段表
+void HeaderTable::Clear() {
+    for(Slice& s : known_) { s = Slice{0, 0}; }
+    otherCount_ = 0;
+    otherSpill_.clear();
+}
+
+// 添加一个字段: 常用字段存入固定槽位, 其余字段按顺序存放
+void HeaderTable::Add(std::string_view name, Slice key, Slice value) {
+    int id = FindKnown_(name);
+    if(id >= 0) {
+        if(known_[id].len == 0) { known_[id] = value; }     // 重复的常用字段以第一个为准
+    } else if(otherCount_ < INLINE_HEADERS) {
+        other_[otherCount_++] = Header{key, value};
+    } else {
+        otherSpill_.push_back(Header{key, value});
+    }
+}
+
+// 按名称查找: 常用字段直接取槽位, 其余字段按顺序比较
+HeaderTable::Slice HeaderTable::Find(const char* base, std::string_view name) const {
+    int id = FindKnown_(name);
+    if(id >= 0) {
+        return known_[id];
+    }
+    for(size_t i = 0; i < otherCount_; i++) {
+        if(EqualsIgnoreCase(std::string_view(base + other_[i].key.off, other_[i].key.len), name)) {
+            return other_[i].value;
+        }
+    }
+    for(const Header& h : otherSpill_) {
+        if(EqualsIgnoreCase(std::string_view(base + h.key.off, h.key.len), name)) { return h.value; }
+    }
+    return Slice{0, 0};
+}
+
+// 查找常用头部字段: 哈希只看长度和首尾字符, 命中槽位后再完整比较一次名称
+int HeaderTable::FindKnown_(std::string_view name) {
+    if(name.empty()) { return -1; }
+    int id = HEADER_SLOTS.id[HeaderHash(name.data(), name.size(), HEADER_SEED)];
+    if(id >= 0 && MatchKnownName(name, KNOWN_HEADERS[id])) {
+        return id;
+    }
+    return -1;
+}
+
+// 不区分大小写比较
+bool HeaderTable::EqualsIgnoreCase(std::string_view a, std::string_view b) {
+    if(a.size() != b.size()) { return false; }
+    for(size_t i = 0; i < a.size(); i++) {
+        if(Lower(a[i]) != Lower(b[i])) { return false; }
+    }
+    return true;
+}
@@ -0,0 +1,60 @@
+#ifndef HEADER_TABLE_H
+#define HEADER_TABLE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+// 请求的头部字段表: 常用字段在添加时通过编译期生成的完美哈希直接存入固定槽位, 之后按编号 O(1) 取值;
+// 其余字段按出现顺序放在内联数组中, 放不下时才使用 vector. 名称都不区分大小写.
+// 字段保存为相对请求起始位置的切片, 读缓冲区搬移数据后仍然有效
+class HeaderTable {
+public:
+    // 常用头部字段
+    enum HEADER {
+        HDR_HOST = 0,
+        HDR_CONNECTION,
+        HDR_CONTENT_TYPE,
+        HDR_CONTENT_LENGTH,
+        HDR_TRANSFER_ENCODING,
+        HDR_ACCEPT_ENCODING,
+        HDR_IF_NONE_MATCH,
+        HDR_IF_MODIFIED_SINCE,
+        HDR_RANGE,
+        HDR_IF_RANGE,
+        HDR_COUNT,
+    };
+    // 请求数据在缓冲区中的切片 (相对请求起始位置的偏移和长度)
+    struct Slice {
+        uint32_t off;
+        uint32_t len;
+    };
+
+    HeaderTable() { Clear(); }
+
+    void Clear();                                   // 清空 (不释放 vector 的容量)
+    // 添加一个字段: name 为名称的内容 (已校验为 token), key/value 为名称和值的切片; 重复的常用字段以第一个为准
+    void Add(std::string_view name, Slice key, Slice value);
+    // 常用字段的值, 不存在时长度为 0
+    Slice Get(HEADER id) const { return known_[id]; }
+    // 按名称查找字段的值, base 为请求的起始位置; 同名字段以第一个为准, 不存在时长度为 0
+    Slice Find(const char* base, std::string_view name) const;
+
+    static bool EqualsIgnoreCase(std::string_view a, std::string_view b);  // 不区分大小写比较
+
+private:
+    struct Header {
+        Slice key;
+        Slice value;
+    };
+    static int FindKnown_(std::string_view name);   // 常用字段的编号, 不是常用字段时返回 -1
+
+    static const size_t INLINE_HEADERS = 16;
+    Slice known_[HDR_COUNT];                        // 常用字段的值, 长度为 0 表示不存在
+    Header other_[INLINE_HEADERS];                  // 其余字段
+    size_t otherCount_;
+    std::vector<Header> otherSpill_;                // 超出内联数组的字段 (clear 不释放容量)
+};
+
+#endif //HEADER_TABLE_H
@@ -4,12 +4,25 @@ using namespace std;
 const char* HttpConn::srcDir;                               // 资源路径
 std::atomic<int> HttpConn::userCount;                       // 用户数量
 bool HttpConn::isET;                                        // 是否边缘触发
+bool HttpConn::tcpCork;                                     // 是否使用 TCP_CORK
+size_t HttpConn::prefetchWindow;                            // 发送前确认在内存中的字节数
+size_t HttpConn::streamWindow;                              // 发送大文件的单个连接的窗口
+size_t HttpConn::streamMem;                                 // 所有发送大文件的连接的窗口总和上限
+std::atomic<int> HttpConn::streamCount;                     // 正在发送大文件的连接数
 
 // 构造函数
 HttpConn::HttpConn() { 
     fd_ = -1;                                               // 文件描述符初始化为-1
     addr_ = { 0 };                                          // 地址初始化
     isClose_ = true;                                        // 连接是否关闭
+    corked_ = false;
+    parsed_ = parseOk_ = false;                             // 没有已解析的请求
+    streaming_ = false;
+    notsentLowat_ = 0;
+    warmFile_ = coldFile_ = nullptr;
+    warmOff_ = warmEnd_ = coldOff_ = 0;
+    coldLen_ = 0;
+    sendMsg_ = {};
 };
 
 // 析构函数
@@ -26,12 +39,18 @@ void HttpConn::init(int fd, const sockaddr_in& addr) {
     writeBuff_.RetrieveAll();                               // 清空写缓冲区
     readBuff_.RetrieveAll();                                // 清空读缓冲区
     isClose_ = false;                                       // 设置客户端为开启状态
+    corked_ = false;
+    parsed_ = false;                                        // 没有已解析的请求
+    notsentLowat_ = 0;                                      // 新的 socket 没有设置 TCP_NOTSENT_LOWAT
+    request_.Init();                                        // 从头开始解析请求
+    warmFile_ = nullptr;
     LOG_INFO("Client[%d](%s:%d) in, userCount:%d", fd_, GetIP(), GetPort(), (int)userCount);
 }
 
 // 关闭连接
 void HttpConn::Close() {
-    response_.UnmapFile();                                  // 解除文件映射
+    response_.ReleaseFile();                                // 释放对缓存文件的引用
+    ReleaseSent_();                                         // 释放未发送完的响应引用的缓存文件
     if(isClose_ == false){
         isClose_ = true;                                    // 设置为关闭状态
         userCount--;                                        // 用户计数减少
@@ -72,61 +91,256 @@ ssize_t HttpConn::read(int* saveErrno) {
     return len;
 }
 
-// 写入数据
+// 开启/关闭 TCP_CORK, 关闭时内核立即发出积攒的不满一个报文段的数据
+void HttpConn::SetCork_(bool on) {
+    int val = on ? 1 : 0;
+    setsockopt(fd_, IPPROTO_TCP, TCP_CORK, &val, sizeof(val));
+    corked_ = on;
+}
+
+// 写入数据. 发送大文件时每轮最多写出一个窗口, 之后让出线程等待下一次可写事件,
+// 慢速客户端不会长时间占用线程, 多个下载之间轮流发送
 ssize_t HttpConn::write(int* saveErrno) {
     ssize_t len = -1;
+    if(tcpCork && !corked_) { SetCork_(true); }            // 响应头和文件内容写完之前不发出不满的报文段
+    size_t window = streaming_ ? StreamWindow_() : SIZE_MAX;
+    size_t written = 0;
     do {
-        len = writev(fd_, iov_, iovCnt_);                   // 使用writev写入数据
+        len = WriteOnce_(window - written);
         if(len <= 0) {
             *saveErrno = errno;                             // 设置错误号
             break;
         }
-        // 更新iov结构体，准备下一次写入
-        if(iov_[0].iov_len + iov_[1].iov_len  == 0) { break; }
-        else if(static_cast<size_t>(len) > iov_[0].iov_len) {
-            iov_[1].iov_base = (uint8_t*) iov_[1].iov_base + (len - iov_[0].iov_len);
-            iov_[1].iov_len -= (len - iov_[0].iov_len);
-            if(iov_[0].iov_len) {
-                writeBuff_.RetrieveAll();
-                iov_[0].iov_len = 0;
-            }
-        }
-        else {
-            iov_[0].iov_base = (uint8_t*)iov_[0].iov_base + len; 
-            iov_[0].iov_len -= len; 
-            writeBuff_.Retrieve(len);
+        written += len;
+        writeBuff_.Retrieve(len);                           // 取出已写出的数据, 归还写完的 slab
+        if(ToWriteBytes() == 0) { break; }
+        if(written >= window) {                             // 这一轮的窗口已用完, 按 EAGAIN 处理 (重新注册写事件)
+            *saveErrno = EAGAIN;
+            len = -1;
+            break;
         }
     } while(isET || ToWriteBytes() > 10240);                // 如果是ET模式或者还有较多数据待发送，继续循环
+    if(ToWriteBytes() == 0) {
+        ReleaseSent_();                                     // 这一批响应已全部写入
+        if(corked_) { SetCork_(false); }                    // 取消 CORK 使尾部数据立即发出
+    }
     return len;
 }
 
+// 写一次: 写缓冲区开头是 sendfile 片段时由内核从页缓存直接发送文件;
+// 否则用 sendmsg 一次写出到下一个 sendfile 片段之前的所有 iovec, 后面还有数据时带上 MSG_MORE,
+// 让响应头与随后 sendfile 的数据合并成满的报文段
+ssize_t HttpConn::WriteOnce_(size_t limit) {
+    if(ToWriteBytes() == 0) {
+        return 0;
+    }
+    int fd;
+    off_t offset;
+    size_t fileLen;
+    const void* tag;
+    if(writeBuff_.PeekFile(&fd, &offset, &fileLen, &tag)) {
+        size_t warm = WarmBytes_(tag, offset, fileLen);
+        if(warm == 0) {
+            errno = EINPROGRESS;                            // 文件内容不在内存中, 先交给 I/O 线程读入
+            return -1;
+        }
+        ssize_t len = sendfile(fd_, fd, &offset, min(warm, limit));
+        if(len == 0) {
+            errno = EIO;                                    // 文件在发送期间被截断, 无法再发送剩余内容
+            return -1;
+        }
+        return len;
+    }
+    struct iovec iov[MAX_IOV];
+    size_t total;
+    int cnt = GatherIov_(iov, &total);
+    if(cnt == 0) {
+        errno = EINPROGRESS;
+        return -1;
+    }
+    struct msghdr msg = {};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = cnt;
+    return sendmsg(fd_, &msg, (total < ToWriteBytes() ? MSG_MORE : 0) | MSG_NOSIGNAL);
+}
+
+// 整理写缓冲区开头的内存数据 (遇到 sendfile 片段时停止).
+// 映射的文件内容不在内存中时只整理到它之前; 只有一部分在内存中时, 只整理到这一部分
+int HttpConn::GatherIov_(struct iovec* iov, size_t* total) {
+    const void* tags[MAX_IOV];
+    int cnt = writeBuff_.PeekIov(iov, tags, MAX_IOV), end = 0;
+    *total = 0;
+    while(end < cnt) {
+        const FileCache::Entry* file = static_cast<const FileCache::Entry*>(tags[end]);
+        size_t warm = file ? WarmBytes_(file, static_cast<const char*>(iov[end].iov_base) - file->data, iov[end].iov_len)
+                           : iov[end].iov_len;
+        if(warm == 0) { break; }
+        *total += warm;
+        if(warm < iov[end].iov_len) {
+            iov[end++].iov_len = warm;
+            break;
+        }
+        end++;
+    }
+    return end;
+}
+
+// recv 完成: 数据在 Epoller 的共享缓冲区中, 复制到读缓冲区 (解析需要连续的请求)
+void HttpConn::RecvDone(const char* data, size_t len) {
+    readBuff_.Append(data, len);
+}
+
+// 准备 sendmsg: 与 WriteOnce_ 相同地整理写缓冲区开头的内存数据, iovec 保存在连接中直到发送完成
+const struct msghdr* HttpConn::PrepareSend(int* flags) {
+    int fd;
+    off_t offset;
+    size_t fileLen;
+    if(ToWriteBytes() == 0 || writeBuff_.PeekFile(&fd, &offset, &fileLen, nullptr)) {
+        return nullptr;
+    }
+    sendIov_.resize(MAX_IOV);
+    size_t total;
+    int cnt = GatherIov_(sendIov_.data(), &total);
+    if(cnt == 0) {
+        return nullptr;                                     // 文件内容不在内存中, 由 write 交给 I/O 线程读入
+    }
+    sendMsg_ = {};
+    sendMsg_.msg_iov = sendIov_.data();
+    sendMsg_.msg_iovlen = cnt;
+    *flags = (total < ToWriteBytes() ? MSG_MORE : 0) | MSG_NOSIGNAL;
+    return &sendMsg_;
+}
+
+// sendmsg 完成: 取出已发送的数据, 全部发送完时与 write 相同地释放
+void HttpConn::SendDone(size_t len) {
+    writeBuff_.Retrieve(len);
+    if(ToWriteBytes() == 0) {
+        ReleaseSent_();
+        if(corked_) { SetCork_(false); }
+    }
+}
+
+// 发送窗口: streamMem 按正在发送大文件的连接数平分, 不超过 streamWindow, 不小于 MIN_STREAM_WINDOW, 取 2 的幂减少变化.
+// 同时把 TCP_NOTSENT_LOWAT 设为窗口大小: 内核中未发送的数据少于窗口时才可写, 每个连接占用的 socket 缓冲区有上限
+size_t HttpConn::StreamWindow_() {
+    size_t share = streamMem / max(streamCount.load(), 1);
+    size_t window = MIN_STREAM_WINDOW;
+    while(window * 2 <= min(share, streamWindow)) { window *= 2; }
+    if(notsentLowat_ != int(window)) {
+        int val = window;
+        setsockopt(fd_, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &val, sizeof(val));
+        notsentLowat_ = val;
+    }
+    return window;
+}
+
+// 检查文件从偏移 off 起的内容是否在内存中, 每次确认最多 prefetchWindow 字节.
+// 不在内存中时记录需要读入的范围, 由调用者交给 I/O 线程, 避免当前线程阻塞在磁盘读取上
+size_t HttpConn::WarmBytes_(const void* tag, off_t off, size_t len) {
+    if(prefetchWindow == 0 || !tag) {
+        return len;
+    }
+    const FileCache::Entry* file = static_cast<const FileCache::Entry*>(tag);
+    if(file == warmFile_ && off >= warmOff_ && off < warmEnd_) {
+        return min(len, size_t(warmEnd_ - off));
+    }
+    size_t window = min(len, prefetchWindow);
+    if(!FileCache::Resident(*file, off, window)) {
+        coldFile_ = file;
+        coldOff_ = off;
+        coldLen_ = window;
+        return 0;
+    }
+    warmFile_ = file;
+    warmOff_ = off;
+    warmEnd_ = off + window;
+    return window;
+}
+
+// 释放已发送的响应占用的 slab 和引用的缓存文件
+void HttpConn::ReleaseSent_() {
+    writeBuff_.RetrieveAll();
+    warmFile_ = nullptr;                                    // 缓存文件可能随之释放, 地址不再有效
+    if(streaming_) {
+        streamCount--;
+        streaming_ = false;
+    }
+}
+
+// 解析读缓冲区中的请求
+bool HttpConn::Parse_() {
+    HttpRequest::HTTP_CODE ret = request_.parse(readBuff_); // 从上次的进度继续解析请求
+    if(ret == HttpRequest::NO_REQUEST) {                    // 请求还不完整, 继续等待数据
+        return false;
+    }
+    parseOk_ = (ret == HttpRequest::GET_REQUEST);
+    parsed_ = true;
+    return true;
+}
+
+// 当前请求是否需要阻塞操作 (登录/注册需要查询数据库)
+bool HttpConn::IsBlocking() {
+    if(!parsed_ && !Parse_()) {
+        return false;
+    }
+    return parseOk_ && request_.NeedVerify();
+}
+
 // 处理HTTP请求并生成响应
+// 读缓冲区中有多个完整的请求 (流水线) 时一次全部处理, 响应按顺序合并到一次 writev 中
 bool HttpConn::process() {
-    request_.Init();                                        // 初始化HTTP请求对象
-    if(readBuff_.ReadableBytes() <= 0) {                    // 如果可读字节小于等于0，则返回false
-        return false;
+    int count = 0;
+    while(count < MAX_PIPELINE && (parsed_ || Parse_())) {
+        // 需要访问数据库的请求留到下一批单独处理 (内联模式下要交给线程池)
+        if(count > 0 && parseOk_ && request_.NeedVerify()) { break; }
+        parsed_ = false;
+        if(!parseOk_) {
+            // 解析失败，初始化HTTP响应对象，设置为400 Bad Request
+            response_.Init(srcDir, request_.path(), false, 400);
+        }
+        else if(!request_.MethodAllowed()) {
+            // 不支持的请求方法 (请求体已经读完, 可以保持连接), 返回405 Method Not Allowed
+            response_.Init(srcDir, request_.path(), request_.IsKeepAlive(), 405);
+        }
+        else if(!request_.Verify()) {                       // 登录/注册验证 (可能访问数据库)
+            // 没有可用的数据库连接, 返回503 Service Unavailable
+            response_.Init(srcDir, request_.path(), false, 503);
+        } else {
+            LOG_DEBUG("%s", request_.path().c_str());       // 记录调试信息
+            // 初始化HTTP响应对象，设置为200 OK
+            response_.Init(srcDir, request_.path(), request_.IsKeepAlive(), 200, &request_);
+        }
+        MakeResponse_();
+        count++;
+        if(!response_.IsKeepAlive()) { break; }             // 连接将在发送后关闭, 之后的请求不再处理
     }
-    else if(request_.parse(readBuff_)) {                    // 解析请求
-        LOG_DEBUG("%s", request_.path().c_str());           // 记录调试信息
-        // 初始化HTTP响应对象，设置为200 OK
-        response_.Init(srcDir, request_.path(), request_.IsKeepAlive(), 200);
-    } else {
-        // 解析失败，初始化HTTP响应对象，设置为400 Bad Request
-        response_.Init(srcDir, request_.path(), false, 400);
+    if(count == 0) {                                        // 没有可以处理的请求
+        // 连接空闲时释放处理大请求时扩容的读缓冲区 (写缓冲区发送完后不占用 slab);
+        // 还有未读完的请求 (如正在接收的大请求体) 时不收缩, 否则每读一段都要重新扩容复制
+        if(readBuff_.ReadableBytes() == 0) {
+            readBuff_.ShrinkTo(IDLE_BUFF_SIZE);
+        }
+        return false;
     }
-    // 生成响应内容
-    response_.MakeResponse(writeBuff_);
-    // 设置响应头的iovec结构
-    iov_[0].iov_base = const_cast<char*>(writeBuff_.Peek());
-    iov_[0].iov_len = writeBuff_.ReadableBytes();
-    iovCnt_ = 1;                                            // iovec计数
-
-    // 如果有文件内容要发送，设置文件内容的iovec结构
-    if(response_.FileLen() > 0  && response_.File()) {
-        iov_[1].iov_base = response_.File();
-        iov_[1].iov_len = response_.FileLen();
-        iovCnt_ = 2;                                        // iovec计数为2，表示有文件内容
-    }   
-    LOG_DEBUG("filesize:%d, %d  to %d", response_.FileLen() , iovCnt_, ToWriteBytes());
     return true;                                            // 返回true表示处理成功
-}
\ No newline at end of file
+}
+
+// 以指定状态码拒绝当前请求 (用于过载保护, 不访问数据库和请求的文件)
+void HttpConn::Reject(int code) {
+    parsed_ = false;
+    response_.Init(srcDir, request_.path(), false, code);
+    MakeResponse_();
+}
+
+// 生成响应内容, 追加到写缓冲区: 响应头复制到 slab 中, 头部块和文件内容只追加引用
+void HttpConn::MakeResponse_() {
+    response_.MakeResponse(writeBuff_);
+    // 请求的各字段不再使用, 从读缓冲区取出已解析的请求数据, 开始解析下一个请求
+    readBuff_.Retrieve(request_.Consumed());
+    request_.Init();
+    if(!streaming_ && writeBuff_.HasFile()) {               // 有 sendfile 片段的连接按发送窗口分批写出
+        streaming_ = true;
+        streamCount++;
+    }
+    LOG_DEBUG("filesize:%zu, %zu bytes pending", response_.FileLen(), ToWriteBytes());
+}
@@ -3,13 +3,19 @@
 
 #include <sys/types.h>
 #include <sys/uio.h>                                // readv/writev
+#include <sys/socket.h>                             // sendmsg, MSG_MORE
+#include <sys/sendfile.h>                           // sendfile
 #include <arpa/inet.h>                              // sockaddr_in
+#include <netinet/tcp.h>                            // TCP_CORK
 #include <stdlib.h>                                 // atoi()
 #include <errno.h>      
+#include <limits.h>                                 // IOV_MAX
+#include <vector>
 
 #include "../log/log.h"
 #include "../pool/sqlconnRAII.h"
 #include "../buffer/buffer.h"
+#include "../buffer/chainbuffer.h"
 #include "httprequest.h"
 #include "httpresponse.h"
 
@@ -28,29 +34,77 @@ public:
     const char* GetIP() const;                      // 获取 IP
     sockaddr_in GetAddr() const;                    // 获取 地址信息
     bool process();                                 // 处理用户请求, 比如解析 HTTP 网页
+    bool IsBlocking();                              // 当前请求是否需要阻塞操作 (如访问数据库), 会先解析请求
+    void Reject(int code);                          // 以指定状态码 (如 503) 拒绝当前请求, 并关闭连接
 
-    int ToWriteBytes() {                            // 待写入数据的字节数
-        return iov_[0].iov_len + iov_[1].iov_len;   
+    // io_uring 完成式读写: 由事件循环线程提交 recv/sendmsg, sendmsg 完成之前不能修改写缓冲区
+    void RecvDone(const char* data, size_t len);    // recv 完成, 读到的 len 字节在 data 中
+    // sendmsg 的参数: 写缓冲区开头可以不阻塞发送的内存数据; 开头是 sendfile 片段或文件内容需要先读入时返回 nullptr,
+    // 由 write 发送. flags 为 sendmsg 的标志
+    const struct msghdr* PrepareSend(int* flags);
+    void SendDone(size_t len);                      // sendmsg 完成 len 字节
+
+    size_t ToWriteBytes() const {                   // 待写入数据的字节数
+        return writeBuff_.ReadableBytes();
+    }
+    // write 因文件内容不在内存中停止 (errno 为 EINPROGRESS) 时, 需要先读入的文件及其范围
+    FileCache::EntryPtr ColdRange(off_t* off, size_t* len) const {
+        *off = coldOff_;
+        *len = coldLen_;
+        return coldFile_->shared_from_this();
     }
-    bool IsKeepAlive() const {                      // 判断是否保持连接
-        return request_.IsKeepAlive();
+    bool IsKeepAlive() const {                      // 判断是否保持连接 (以已生成的响应为准, 错误响应会关闭连接)
+        return response_.IsKeepAlive();
     }
 
     static bool isET;                               // 是否使用边缘触发
+    static bool tcpCork;                            // 写响应期间是否开启 TCP_CORK
     static const char* srcDir;                      // 静态资源目录
+    static size_t prefetchWindow;                   // 发送文件前确认在内存中的字节数, 0 表示不检查 (可能阻塞在缺页上)
+    static size_t streamWindow;                     // 发送大文件的连接每轮最多写出的字节数 (也是内核中未发送数据的上限)
+    static size_t streamMem;                        // 所有发送大文件的连接的窗口总和上限, 连接多时缩小每个连接的窗口
+    static std::atomic<int> streamCount;            // 正在发送大文件 (sendfile) 的连接数
     static std::atomic<int> userCount;              // 客户端连接数
 
 private:
+    bool Parse_();                                  // 解析读缓冲区中的请求, 没有数据时返回 false
+    void MakeResponse_();                           // 生成响应, 追加到写缓冲区
+    void ReleaseSent_();                            // 全部发送完成后释放写缓冲区和引用的缓存文件
+    ssize_t WriteOnce_(size_t limit);               // 从写缓冲区开头写一次 (sendmsg 或 sendfile, 后者最多 limit 字节)
+    // 写缓冲区开头可以不阻塞发送的内存数据整理为 iovec (最多 MAX_IOV 个), 返回个数并给出总字节数, 0 表示需要先读入
+    int GatherIov_(struct iovec* iov, size_t* total);
+    size_t StreamWindow_();                         // 这一轮的发送窗口, 并设置相应的 TCP_NOTSENT_LOWAT
+    // 文件片段 (标记为所属的缓存条目) 从偏移 off 起可以不阻塞发送的字节数 (最多 len), 0 表示需要先读入
+    size_t WarmBytes_(const void* tag, off_t off, size_t len);
+    void SetCork_(bool on);                         // 开启/关闭 TCP_CORK
+
     int fd_;                                        // 文件描述符
     struct  sockaddr_in addr_;                      // 客户端地址信息 (协议族, TCP, IP 端口)
 
     bool isClose_;                                  // 连接是否关闭
+    bool corked_;                                   // 当前是否处于 TCP_CORK 状态
+    bool parsed_;                                   // 当前请求是否已被 IsBlocking 提前解析
+    bool parseOk_;                                  // 当前请求是否解析成功
+    bool streaming_;                                // 写缓冲区中是否有 sendfile 片段 (计入 streamCount)
+    int notsentLowat_;                              // 当前设置的 TCP_NOTSENT_LOWAT, 0 表示未设置
     
-    int iovCnt_;                                    // 分散读写的通道数
-    struct iovec iov_[2];                           // iovec 数组，用于分散读写
+    const FileCache::Entry* warmFile_;              // 最近确认在内存中的文件
+    off_t warmOff_;                                 // 该文件确认在内存中的范围 [warmOff_, warmEnd_)
+    off_t warmEnd_;
+    const FileCache::Entry* coldFile_;              // 需要先读入的文件
+    off_t coldOff_;                                 // 需要先读入的范围
+    size_t coldLen_;
+    static const int MAX_PIPELINE = 32;             // 一批最多处理的流水线请求数
+    static const int MAX_IOV = 128;                 // 一次 sendmsg 最多写出的 iovec 数
+    static const size_t MIN_STREAM_WINDOW = 16 * 1024;  // 连接很多时每个连接的发送窗口下限
+    static const size_t IDLE_BUFF_SIZE = 16 * 1024; // 连接空闲时读缓冲区收缩到的大小
     
-    Buffer readBuff_;                               // 读缓冲区
-    Buffer writeBuff_;                              // 写缓冲区
+    Buffer readBuff_;                               // 读缓冲区 (解析请求需要连续的内存)
+    // 写缓冲区: 一批响应的头部复制到 slab 中, 文件内容和头部块按顺序作为引用追加, 发送时直接整理为 iovec;
+    // 写出的 slab 随即归还, 引用的缓存文件在其响应写完后释放
+    ChainBuffer writeBuff_;
+    std::vector<struct iovec> sendIov_;             // 已提交的 sendmsg 的 iovec 和 msghdr, 完成之前保持不变
+    struct msghdr sendMsg_;
 
     HttpRequest request_;                           // HTTP请求对象
     HttpResponse response_;                         // HTTP响应对象
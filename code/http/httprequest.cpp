@@ -12,80 +12,217 @@ const unordered_map<string, int> HttpRequest::DEFAULT_HTML_TAG {
 
 // 初始化HTTP请求
 void HttpRequest::Init() {
-    method_ = path_ = version_ = body_ = "";        // 初始化方法、路径、版本和主体为空字符串
+    path_.clear();                                  // 清空路径和主体 (保留容量)
+    body_.clear();
+    method_ = version_ = Slice{0, 0};
+    base_ = nullptr;
+    pos_ = 0;
+    bodyLen_ = 0;
     state_ = REQUEST_LINE;                          // 设置初始解析状态为请求行
-    header_.clear();                                // 清空头部字段
+    verifyTag_ = -1;                                // 没有待验证的表单
+    headers_.Clear();                               // 清空头部字段
     post_.clear();                                  // 清空POST数据
 }
 
 // 判断是否保持连接
 bool HttpRequest::IsKeepAlive() const {
     // 检查Connection头部字段是否为keep-alive，并且版本为1.1
-    if(header_.count("Connection") == 1) {
-        return header_.find("Connection")->second == "keep-alive" && version_ == "1.1";
+    return HeaderTable::EqualsIgnoreCase(GetHeader(HeaderTable::HDR_CONNECTION), "keep-alive") && version() == "1.1";
+}
+
+// 是否还需要登录/注册验证
+bool HttpRequest::NeedVerify() const {
+    return verifyTag_ >= 0;
+}
+
+// 执行登录/注册验证 (访问数据库, 可能阻塞, 不应在事件循环线程上调用)
+bool HttpRequest::Verify() {
+    if(verifyTag_ < 0) { return true; }
+    bool isLogin = (verifyTag_ == 1);
+    verifyTag_ = -1;
+    MYSQL* sql;
+    SqlConnRAII sqlRAII(&sql, SqlConnPool::Instance());   // 获取数据库连接, 离开作用域时归还
+    if(!sql) {
+        LOG_WARN("No free sql connection!");
+        return false;                               // 连接池耗尽, 由调用者返回 503
     }
-    return false;
+    if(UserVerify(sql, post_["username"], post_["password"], isLogin)) {
+        path_ = "/welcome.html";                    // 验证成功
+    } 
+    else {
+        path_ = "/error.html";                      // 验证失败
+    }
+    return true;
 }
 
 // 解析HTTP请求
-bool HttpRequest::parse(Buffer& buff) {
-    const char CRLF[] = "\r\n";                     // 行结束标识
-    if(buff.ReadableBytes() <= 0) {
-        return false;
-    }
-    while(buff.ReadableBytes() && state_ != FINISH) {
-        const char* lineEnd = search(buff.Peek(), buff.BeginWriteConst(), CRLF, CRLF + 2);
-        std::string line(buff.Peek(), lineEnd);     // 获取一行数据
+// 逐行推进的状态机: pos_ 记录下一行的起始位置, 数据不完整时保留进度, 下次只扫描新到达的数据.
+// 请求数据保留在缓冲区中, 由调用者在生成响应后根据 Consumed() 取出
+HttpRequest::HTTP_CODE HttpRequest::parse(Buffer& buff) {
+    base_ = buff.Peek();                            // 缓冲区可能已搬移, 重新定位
+    const char* end = buff.BeginWriteConst();
+    while(state_ != FINISH) {
+        const char* lineBegin = base_ + pos_;
+        if(state_ == BODY) {
+            if(static_cast<size_t>(end - lineBegin) < bodyLen_) {
+                return NO_REQUEST;                  // 请求体还没有收全
+            }
+            ParseBody_(lineBegin, lineBegin + bodyLen_);  // 解析主体
+            pos_ += bodyLen_;
+            break;
+        }
+        // 查找行结束符, 兼容只有 LF 的行
+        const char* lineEnd = HttpScan::FindChar(lineBegin, end, '\n');
+        if(static_cast<size_t>(lineEnd - base_) > MAX_HEAD_SIZE) {
+            LOG_WARN("Request head too large");     // 请求行和头部过长
+            return BAD_REQUEST;
+        }
+        if(lineEnd == end) {
+            return NO_REQUEST;                      // 行还不完整, 等待更多数据
+        }
+        const char* next = lineEnd + 1;
+        if(lineEnd > lineBegin && lineEnd[-1] == '\r') { lineEnd--; }
         switch(state_)
         {
         case REQUEST_LINE:
-            if(!ParseRequestLine_(line)) {          // 解析请求行失败
-                return false;
+            if(lineBegin == lineEnd) { break; }     // 忽略请求行之前的空行
+            if(!ParseRequestLine_(lineBegin, lineEnd)) {  // 解析请求行失败
+                return BAD_REQUEST;
+            }
+            if(!ParsePath_()) {                     // 解析路径
+                LOG_WARN("Bad request path");
+                return BAD_REQUEST;
             }
-            ParsePath_();                           // 解析路径
             break;    
         case HEADERS:
-            ParseHeader_(line);                     // 解析头部字段
-            if(buff.ReadableBytes() <= 2) {
-                state_ = FINISH;
+            if(!ParseHeader_(lineBegin, lineEnd)) { // 解析头部字段, 遇到空行时进入 BODY
+                return BAD_REQUEST;
+            }
+            if(state_ == BODY && !ParseBodyLength_()) {
+                return BAD_REQUEST;
             }
-            break;
-        case BODY:
-            ParseBody_(line);                       // 解析主体
             break;
         default:
             break;
         }
-        if(lineEnd == buff.BeginWrite()) { break; }
-        buff.RetrieveUntil(lineEnd + 2);            // 移动缓冲区读取位置
+        pos_ = next - base_;
+    }
+    LOG_DEBUG("[%.*s], [%s], [%.*s]", (int)method_.len, base_ + method_.off, path_.c_str(),
+                (int)version_.len, base_ + version_.off);
+    return GET_REQUEST;
+}
+
+// 根据 Content-Length 确定请求体长度, 没有时请求体为空; 不支持分块传输编码
+bool HttpRequest::ParseBodyLength_() {
+    bodyLen_ = 0;
+    if(!GetHeader(HeaderTable::HDR_TRANSFER_ENCODING).empty()) {
+        LOG_ERROR("Transfer-Encoding not supported");
+        return false;
+    }
+    std::string_view len = GetHeader(HeaderTable::HDR_CONTENT_LENGTH);
+    for(char ch : len) {
+        if(ch < '0' || ch > '9') {
+            LOG_ERROR("Content-Length Error");
+            return false;
+        }
+        bodyLen_ = bodyLen_ * 10 + (ch - '0');
+        if(bodyLen_ > MAX_BODY_SIZE) {
+            LOG_WARN("Request body too large");
+            return false;
+        }
     }
-    LOG_DEBUG("[%s], [%s], [%s]", method_.c_str(), path_.c_str(), version_.c_str());
     return true;
 }
 
+// 当前请求占用的缓冲区字节数
+size_t HttpRequest::Consumed() const {
+    return pos_;
+}
+
+// 由缓冲区中的指针区间生成切片
+HttpRequest::Slice HttpRequest::MakeSlice_(const char* begin, const char* end) const {
+    return Slice{static_cast<uint32_t>(begin - base_), static_cast<uint32_t>(end - begin)};
+}
+
+// 将切片还原为视图
+std::string_view HttpRequest::View_(const Slice& s) const {
+    if(s.len == 0) { return std::string_view(); }
+    return std::string_view(base_ + s.off, s.len);
+}
+
 // 解析路径
-void HttpRequest::ParsePath_() {
-    if(path_ == "/") {
-        path_ = "/index.html";                      // 默认路径
+// 规范化请求路径: 去掉查询串和片段, 解码 %XX, 合并 "//"、"." 和 ".." (不能越过根目录), 都在 path_ 中原地完成.
+// 同一文件的不同写法得到同一个路径, 直接作为文件缓存的键, 也不会访问到资源目录之外的文件
+bool HttpRequest::ParsePath_() {
+    string& p = path_;
+    size_t end = p.find_first_of("?#");
+    if(end != string::npos) { p.resize(end); }
+    if(p.empty() || p[0] != '/') {
+        return false;                               // 只接受绝对路径 (不支持 "*" 和完整 URL)
     }
-    else {
-        for(auto &item: DEFAULT_HTML) {
-            if(item == path_) {
-                path_ += ".html";                   // 添加默认HTML文件后缀
-                break;
+    auto hex = [](char ch) {
+        if(ch >= '0' && ch <= '9') return ch - '0';
+        if(ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+        if(ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+        return -1;
+    };
+    size_t w = 0;
+    for(size_t r = 0; r < p.size(); r++, w++) {
+        p[w] = p[r];
+        if(p[r] != '%') { continue; }
+        int hi = r + 2 < p.size() ? hex(p[r + 1]) : -1;
+        int lo = hi >= 0 ? hex(p[r + 2]) : -1;
+        if(lo < 0 || (hi == 0 && lo == 0)) {
+            return false;                           // 不完整的转义或 NUL
+        }
+        p[w] = char(hi << 4 | lo);
+        r += 2;
+    }
+    p.resize(w);
+    // 逐段复制到前面: 空段和 "." 跳过, ".." 删除已复制的最后一段
+    w = 0;
+    bool dirEnd = false;                            // 路径是否以目录结尾 (需要保留结尾的 '/')
+    for(size_t r = 0; r < p.size(); ) {
+        size_t next = min(p.find('/', r + 1), p.size());
+        size_t len = next - r - 1;
+        dirEnd = len == 0 || (len == 1 && p[r + 1] == '.') || (len == 2 && p[r + 1] == '.' && p[r + 2] == '.');
+        if(len == 2 && p[r + 1] == '.' && p[r + 2] == '.') {
+            if(w == 0) {
+                return false;                       // 越过资源目录的根
             }
+            w = p.rfind('/', w - 1);
+        } else if(!dirEnd) {
+            memmove(&p[w], &p[r], len + 1);
+            w += len + 1;
         }
+        r = next;
+    }
+    p.resize(w);
+    if(w == 0 || dirEnd) { p += '/'; }
+    // 默认页面和无后缀的页面路由
+    if(p == "/") {
+        p = "/index.html";                          // 默认路径
+    } else if(DEFAULT_HTML.count(p)) {
+        p += ".html";                               // 添加默认HTML文件后缀
     }
+    return true;
 }
 
-// 解析HTTP请求行
-bool HttpRequest::ParseRequestLine_(const string& line) {
-    regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$"); // 正则表达式，匹配请求行
-    smatch subMatch;                                // 用于存储匹配结果
-    if(regex_match(line, subMatch, patten)) {   
-        method_ = subMatch[1];                      // 获取请求方法
-        path_ = subMatch[2];                        // 获取请求路径
-        version_ = subMatch[3];                     // 获取HTTP版本
+// 解析HTTP请求行: "方法 路径 HTTP/版本"
+bool HttpRequest::ParseRequestLine_(const char* begin, const char* end) {
+    // 方法必须是非空的 token, 其后紧跟空格
+    const char* sp1 = HttpScan::FindTokenEnd(begin, end);
+    if(sp1 == begin || sp1 == end || *sp1 != ' ') {
+        LOG_ERROR("RequestLine Error");
+        return false;
+    }
+    const char* sp2 = HttpScan::FindChar(sp1 + 1, end, ' ');
+    // 版本部分必须以 "HTTP/" 开头, 且不能再包含空格
+    if(sp2 != end && end - sp2 > 5 && memcmp(sp2 + 1, "HTTP/", 5) == 0
+        && HttpScan::FindChar(sp2 + 6, end, ' ') == end) {
+        method_ = MakeSlice_(begin, sp1);           // 获取请求方法
+        path_.assign(sp1 + 1, sp2);                 // 获取请求路径
+        version_ = MakeSlice_(sp2 + 6, end);        // 获取HTTP版本
         state_ = HEADERS;                           // 更新解析状态为HEADERS
         return true;
     }
@@ -93,24 +230,31 @@ bool HttpRequest::ParseRequestLine_(const string& line) {
     return false;
 }
 
-// 解析HTTP头部
-void HttpRequest::ParseHeader_(const string& line) {
-    regex patten("^([^:]*): ?(.*)$");               // 正则表达式，匹配头部字段
-    smatch subMatch;
-    if(regex_match(line, subMatch, patten)) {
-        header_[subMatch[1]] = subMatch[2];         // 存储头部字段
-    }
-    else {
+// 解析HTTP头部: "名称: 值", 空行表示头部结束
+bool HttpRequest::ParseHeader_(const char* begin, const char* end) {
+    if(begin == end) {
         state_ = BODY;                              // 头部解析完成，更新解析状态为BODY
+        return true;
+    }
+    // 头部名称必须是非空的 token, 其后紧跟 ':'
+    const char* colon = HttpScan::FindTokenEnd(begin, end);
+    if(colon == begin || colon == end || *colon != ':') {
+        LOG_ERROR("Header Error");                  // 头部格式错误
+        return false;
     }
+    const char* value = colon + 1;                  // 去掉值两端的空白
+    while(value < end && (*value == ' ' || *value == '\t')) { value++; }
+    while(end > value && (end[-1] == ' ' || end[-1] == '\t')) { end--; }
+    headers_.Add(std::string_view(begin, colon - begin), MakeSlice_(begin, colon), MakeSlice_(value, end));
+    return true;
 }
 
 // 解析HTTP主体
-void HttpRequest::ParseBody_(const string& line) {
-    body_ = line;                                   // 获取主体内容
+void HttpRequest::ParseBody_(const char* begin, const char* end) {
+    body_.assign(begin, end);                       // 获取主体内容
     ParsePost_();                                   // 解析POST数据
     state_ = FINISH;                                // 更新解析状态为FINISH
-    LOG_DEBUG("Body:%s, len:%d", line.c_str(), line.size());
+    LOG_DEBUG("Body:%s, len:%d", body_.c_str(), body_.size());
 }
 
 // 将十六进制字符转换为十进制数
@@ -122,20 +266,16 @@ int HttpRequest::ConverHex(char ch) {
 
 // 解析POST请求
 void HttpRequest::ParsePost_() {
-    if(method_ == "POST" && header_["Content-Type"] == "application/x-www-form-urlencoded") {
+    // Content-Type 可能带有 "; charset=..." 参数, 只比较媒体类型
+    std::string_view type = GetHeader(HeaderTable::HDR_CONTENT_TYPE);
+    type = type.substr(0, type.find(';'));
+    while(!type.empty() && (type.back() == ' ' || type.back() == '\t')) { type.remove_suffix(1); }
+    if(method() == "POST" && HeaderTable::EqualsIgnoreCase(type, "application/x-www-form-urlencoded")) {
         ParseFromUrlencoded_();                     // 解析application/x-www-form-urlencoded类型的数据
-        // 检查路径是否在默认的HTML标签中
+        // 检查路径是否在默认的HTML标签中, 登录或注册请求留给 Verify 处理 (访问数据库)
         if(DEFAULT_HTML_TAG.count(path_)) {
-            int tag = DEFAULT_HTML_TAG.find(path_)->second;
-            LOG_DEBUG("Tag:%d", tag);
-            // 根据标签处理登录或注册请求
-            bool isLogin = (tag == 1);
-            if(UserVerify(post_["username"], post_["password"], isLogin)) {
-                path_ = "/welcome.html";            // 验证成功
-            } 
-            else {
-                path_ = "/error.html";              // 验证失败
-            }
+            verifyTag_ = DEFAULT_HTML_TAG.find(path_)->second;
+            LOG_DEBUG("Tag:%d", verifyTag_);
         }
     }
 }
@@ -185,11 +325,9 @@ void HttpRequest::ParseFromUrlencoded_() {
 }
 
 // 用户验证
-bool HttpRequest::UserVerify(const string &name, const string &pwd, bool isLogin) {
+bool HttpRequest::UserVerify(MYSQL* sql, const string &name, const string &pwd, bool isLogin) {
     if(name == "" || pwd == "") { return false; }   // 如果用户名或密码为空，返回false
     LOG_INFO("Verify name:%s pwd:%s", name.c_str(), pwd.c_str());
-    MYSQL* sql;
-    SqlConnRAII(&sql,  SqlConnPool::Instance());    // 获取数据库连接
     assert(sql);                                    // 确保数据库连接有效
 
     bool flag = false;
@@ -238,13 +376,12 @@ bool HttpRequest::UserVerify(const string &name, const string &pwd, bool isLogin
         }
         flag = true;
     }
-    SqlConnPool::Instance()->FreeConn(sql);         // 释放数据库连接
     LOG_DEBUG( "UserVerify success!!");
     return flag;
 }
 
 // 获取请求路径
-std::string HttpRequest::path() const {
+const std::string& HttpRequest::path() const {
     return path_;
 }
 
@@ -253,28 +390,27 @@ std::string& HttpRequest::path() {
 }
 
 // 获取请求方法
-std::string HttpRequest::method() const {
-    return method_;
+std::string_view HttpRequest::method() const {
+    return View_(method_);
+}
+
+// 是否为支持的请求方法, 其它方法返回 405
+bool HttpRequest::MethodAllowed() const {
+    std::string_view m = method();
+    return m == "GET" || m == "HEAD" || m == "POST";
 }
 
 // 获取HTTP版本
-std::string HttpRequest::version() const {
-    return version_;
+std::string_view HttpRequest::version() const {
+    return View_(version_);
 }
 
-// 获取POST请求的参数
-std::string HttpRequest::GetPost(const std::string& key) const {
-    assert(key != "");
-    if(post_.count(key) == 1) {
-        return post_.find(key)->second;
-    }
-    return "";
+// 获取常用头部字段
+std::string_view HttpRequest::GetHeader(HEADER id) const {
+    return View_(headers_.Get(id));
 }
 
-std::string HttpRequest::GetPost(const char* key) const {
-    assert(key != nullptr);
-    if(post_.count(key) == 1) {
-        return post_.find(key)->second;
-    }
-    return "";
-}
\ No newline at end of file
+// 获取头部字段, 名称不区分大小写; 同名字段以第一个为准
+std::string_view HttpRequest::GetHeader(std::string_view key) const {
+    return View_(headers_.Find(base_, key));
+}
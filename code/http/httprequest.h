@@ -4,7 +4,9 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <string>
-#include <regex>
+#include <string_view>
+#include <vector>
+#include <cstring>
 #include <errno.h>     
 #include <mysql/mysql.h>  //mysql
 
@@ -12,6 +14,8 @@
 #include "../log/log.h"
 #include "../pool/sqlconnpool.h"
 #include "../pool/sqlconnRAII.h"
+#include "httpscan.h"
+#include "headertable.h"
 
 // HttpRequest 类，用于解析HTTP请求
 class HttpRequest {
@@ -35,37 +39,60 @@ public:
         CLOSED_CONNECTION,                          // 关闭连接
     };
     
+    typedef HeaderTable::HEADER HEADER;             // 常用头部字段 (HeaderTable::HDR_*)
+    
     HttpRequest() { Init(); }                       // 构造函数
     ~HttpRequest() = default;                       // 析构函数
 
-    void Init();                                    // 初始化HttpRequest对象
-    bool parse(Buffer& buff);                       // 解析HTTP请求
+    void Init();                                    // 初始化HttpRequest对象, 开始解析新的请求
+    // 从上次的进度继续解析HTTP请求 (不移动缓冲区读指针)
+    // 返回 GET_REQUEST 表示请求完整, NO_REQUEST 表示数据不完整需要继续读取, BAD_REQUEST 表示格式错误
+    HTTP_CODE parse(Buffer& buff);
+    size_t Consumed() const;                        // 当前请求占用的缓冲区字节数, 响应生成后由调用者取出
 
-    std::string path() const;                       // 获取请求路径
+    // method/version/header 返回指向读缓冲区的视图, 在调用者取出请求数据之前有效
+    const std::string& path() const;                // 获取请求路径
     std::string& path();                
-    std::string method() const;                     // 获取请求方法
-    std::string version() const;                    // 获取HTTP版本
+    std::string_view method() const;                // 获取请求方法
+    std::string_view version() const;               // 获取HTTP版本
+    std::string_view GetHeader(HEADER id) const;    // 获取常用头部字段, 不存在时返回空视图
+    std::string_view GetHeader(std::string_view key) const;  // 获取头部字段 (名称不区分大小写)
     std::string GetPost(const std::string& key) const;
     std::string GetPost(const char* key) const;     // 获取POST请求的数据
 
     bool IsKeepAlive() const;                       // 判断连接是否保持活跃
+    bool NeedVerify() const;                        // 是否还需要登录/注册验证 (会访问数据库)
+    bool MethodAllowed() const;                     // 是否为支持的请求方法 (GET、HEAD、POST)
+    bool Verify();                                  // 执行登录/注册验证并据此设置响应路径, 没有可用的数据库连接时返回 false
 
 private:
-    bool ParseRequestLine_(const std::string& line);// 解析请求行
-    void ParseHeader_(const std::string& line);     // 解析请求头
-    void ParseBody_(const std::string& line);       // 解析请求体
-    void ParsePath_();                              // 解析路径
+    // 请求数据在缓冲区中的切片, 记录相对请求起始位置的偏移, 缓冲区搬移数据后仍然有效
+    typedef HeaderTable::Slice Slice;
+    Slice MakeSlice_(const char* begin, const char* end) const;
+    std::string_view View_(const Slice& s) const;
+
+    bool ParseRequestLine_(const char* begin, const char* end);  // 解析请求行
+    bool ParseHeader_(const char* begin, const char* end);       // 解析请求头
+    void ParseBody_(const char* begin, const char* end);         // 解析请求体
+    bool ParseBodyLength_();                        // 根据 Content-Length 确定请求体长度
+    bool ParsePath_();                              // 规范化路径并映射默认页面, 路径非法或越过根目录时返回 false
     void ParsePost_();                              // 解析POST请求
     void ParseFromUrlencoded_();                    // 解析application/x-www-form-urlencoded格式的数据
     // 用户验证（用于登录或注册等功能）
-    static bool UserVerify(const std::string& name, const std::string& pwd, bool isLogin);
+    static bool UserVerify(MYSQL* sql, const std::string& name, const std::string& pwd, bool isLogin);
 
     PARSE_STATE state_;                             // 当前解析状态
-    std::string method_, path_, version_, body_;    // 请求方法、路径、版本和主体
-    // 头部信息
-    std::unordered_map<std::string, std::string> header_;
+    int verifyTag_;                                 // 待验证的表单标签 (0 注册, 1 登录, -1 无)
+    const char* base_;                              // 请求在读缓冲区中的起始位置 (每次 parse 时更新)
+    size_t pos_;                                    // 已解析的字节数 (下一行的起始偏移)
+    size_t bodyLen_;                                // 请求体长度
+    Slice method_, version_;                        // 请求方法、版本
+    std::string path_, body_;                       // 请求路径、主体 (会被改写, 保存副本, 复用容量)
+    HeaderTable headers_;                           // 头部信息
     // POST数据
     std::unordered_map<std::string, std::string> post_;
+    static const size_t MAX_HEAD_SIZE = 8192;       // 请求行和头部的最大长度
+    static const size_t MAX_BODY_SIZE = 1 << 20;    // 请求体的最大长度
     // 默认的HTML文件集合
     static const std::unordered_set<std::string> DEFAULT_HTML;
     // 默认的HTML标签
@@ -22,14 +22,32 @@ const unordered_map<string, string> HttpResponse::SUFFIX_TYPE = {
     { ".tar",   "application/x-tar" },
     { ".css",   "text/css "},
     { ".js",    "text/javascript "},
+    { ".json",  "application/json" },
+    { ".svg",   "image/svg+xml" },
+    { ".ico",   "image/x-icon" },
+    { ".ttf",   "font/ttf" },
+    { ".otf",   "font/otf" },
+    { ".eot",   "application/vnd.ms-fontobject" },
+    { ".woff",  "font/woff" },
+    { ".woff2", "font/woff2" },
+};
+
+// 可以压缩的文件后缀, 这些文件会查找预压缩的 .br/.gz 版本或即时压缩 (woff/woff2 和图片本身已经压缩过, 不再压缩)
+const unordered_set<string> HttpResponse::COMPRESSIBLE = {
+    ".html", ".xml", ".xhtml", ".txt", ".css", ".js", ".json", ".svg", ".ico", ".ttf", ".otf", ".eot",
 };
 
 // HTTP状态码到状态消息的映射
 const unordered_map<int, string> HttpResponse::CODE_STATUS = {
     { 200, "OK" },
+    { 206, "Partial Content" },
+    { 304, "Not Modified" },
     { 400, "Bad Request" },
     { 403, "Forbidden" },
     { 404, "Not Found" },
+    { 405, "Method Not Allowed" },
+    { 416, "Range Not Satisfiable" },
+    { 503, "Service Unavailable" },
 };
 
 // 特定状态码到错误页面文件路径的映射
@@ -37,55 +55,126 @@ const unordered_map<int, string> HttpResponse::CODE_PATH = {
     { 400, "/400.html" },
     { 403, "/403.html" },
     { 404, "/404.html" },
+    { 405, "/405.html" },
+    { 503, "/503.html" },
 };
 
+int HttpResponse::retryAfter = 1;
+std::atomic<unsigned long> HttpResponse::boundaryCount_;
+std::unordered_map<std::string, FileCache::EntryPtr> HttpResponse::errorBodies_;
+std::mutex HttpResponse::errorMtx_;
+
 // 构造函数
 HttpResponse::HttpResponse() {
     code_ = -1;                             // 初始化HTTP状态码为-1
     path_ = srcDir_ = "";                   // 初始化路径和源目录为空字符串
     isKeepAlive_ = false;                   // 初始化为非持久连接
-    mmFile_ = nullptr;                      // 初始化内存映射文件指针为null
+    isHead_ = false;
+    etag_[0] = '\0';
     mmFileStat_ = { 0 };                    // 初始化文件状态结构
 };
 
 // 析构函数
 HttpResponse::~HttpResponse() {
-    UnmapFile();                            // 调用UnmapFile解除文件映射
+    ReleaseFile();                          // 释放对缓存文件的引用
 }
 
 // 初始化HttpResponse对象
-void HttpResponse::Init(const string& srcDir, string& path, bool isKeepAlive, int code){
+void HttpResponse::Init(const string& srcDir, string& path, bool isKeepAlive, int code,
+                        const HttpRequest* request){
     assert(srcDir != "");                   // 断言源目录非空
-    if(mmFile_) { UnmapFile(); }            // 如果已有文件映射，则解除映射
+    ReleaseFile();                          // 如果引用了缓存文件，则释放
     code_ = code;                           // 设置HTTP状态码
     isKeepAlive_ = isKeepAlive;             // 设置连接是否保持活跃
     path_ = path;                           // 设置请求路径
     srcDir_ = srcDir;                       // 设置源文件目录
-    mmFile_ = nullptr;                      // 重置内存映射文件指针
     mmFileStat_ = { 0 };                    // 重置文件状态结构
+    etag_[0] = '\0';
+    // 条件请求头指向读缓冲区, 在 MakeResponse 之后不再使用
+    isHead_ = request && request->method() == "HEAD";
+    ifNoneMatch_ = request ? request->GetHeader(HeaderTable::HDR_IF_NONE_MATCH) : string_view();
+    ifModifiedSince_ = request ? request->GetHeader(HeaderTable::HDR_IF_MODIFIED_SINCE) : string_view();
+    range_ = request ? request->GetHeader(HeaderTable::HDR_RANGE) : string_view();
+    ifRange_ = request ? request->GetHeader(HeaderTable::HDR_IF_RANGE) : string_view();
+    acceptEncoding_ = request ? request->GetHeader(HeaderTable::HDR_ACCEPT_ENCODING) : string_view();
+    encoding_ = nullptr;
+    vary_ = false;
 }
 
-// 构建HTTP响应
-void HttpResponse::MakeResponse(Buffer& buff) {
-    // 判断请求的资源文件是否存在且可访问
-    if(stat((srcDir_ + path_).data(), &mmFileStat_) < 0 || S_ISDIR(mmFileStat_.st_mode)) {
+// 构建HTTP响应; 响应引用的缓存文件交给写缓冲区保持, 响应发送完成后释放
+void HttpResponse::MakeResponse(ChainBuffer& buff) {
+    // 错误响应 (如解析失败、过载拒绝) 不检查所请求的文件, 直接返回错误页面
+    if(code_ >= 400) {}
+    // 判断请求的资源文件是否存在且可访问 (文件状态来自文件缓存, 命中时不访问文件系统)
+    else if(!(file_ = FileCache::Instance()->Get(path_))->exists || S_ISDIR(file_->st.st_mode)) {
         code_ = 404;                        // 如果文件不存在或是目录，则设置状态码为404
     }
-    else if(!(mmFileStat_.st_mode & S_IROTH)) {
+    else if(!(file_->st.st_mode & S_IROTH)) {
         code_ = 403;                        // 如果文件没有读权限，则设置状态码为403
     }
     else if(code_ == -1) { 
         code_ = 200;                        // 如果之前没有设置状态码，则默认为200
     }
+    if(code_ == 200) {
+        SelectEncoding_();                  // 客户端接受时改为发送预压缩的文件
+        mmFileStat_ = file_->st;
+        // 由 inode、修改时间 (纳秒) 和大小生成 ETag, 文件被替换或修改后都会变化
+        snprintf(etag_, sizeof(etag_), "\"%lx-%llx-%llx\"", (unsigned long)mmFileStat_.st_ino,
+                 (unsigned long long)mmFileStat_.st_mtim.tv_sec * 1000000000ULL + mmFileStat_.st_mtim.tv_nsec,
+                 (unsigned long long)mmFileStat_.st_size);
+        if(NotModified_()) {
+            code_ = 304;                    // 客户端缓存仍然有效, 不发送响应体
+        }
+        else if(!range_.empty() && IfRangeMatch_()) {
+            code_ = ParseRange_();          // 只发送请求的字节区间
+        }
+    }
     ErrorHtml_();                           // 根据状态码设置错误页面
-    AddStateLine_(buff);                    // 添加状态行到响应缓冲区
-    AddHeader_(buff);                       // 添加响应头部
-    AddContent_(buff);                      // 添加响应内容
+    // 完整的文件、304 和错误页面使用缓存条目中预先生成的头部块, 不复制到写缓冲区, 作为单独的 iovec 发送;
+    // 写缓冲区中只追加 Connection、Date 等每个响应不同的头部
+    const string* head = HeadBlock_();
+    if(head) {
+        buff.AppendRef(head->data(), head->size());
+        AddConnHeader_(buff);
+        buff.Append("\r\n", 2);
+        if(code_ != 304 && !isHead_ && mmFileStat_.st_size > 0) {
+            AddSpan_(buff, 0, mmFileStat_.st_size);
+        }
+    } else {
+        AddStateLine_(buff);                // 添加状态行到响应缓冲区
+        AddHeader_(buff);                   // 添加响应头部
+        AddContent_(buff);                  // 添加响应内容
+    }
+    buff.Hold(std::move(file_));            // 引用的头部块和文件内容在缓存条目中
 }
 
-// 返回内存映射的文件数据
-char* HttpResponse::File() {
-    return mmFile_;
+// 头部块: 状态行, 验证器、Content-type 和 Content-length 等只取决于文件和状态码的头部.
+// 每个缓存条目按状态码分别生成一次, 之后的响应直接引用
+const string* HttpResponse::HeadBlock_() {
+    int slot;
+    if(code_ == 200 || code_ == 304) {
+        slot = code_ == 200 ? HEAD_OK : HEAD_NOT_MODIFIED;
+    } else if(CODE_PATH.count(code_) == 1) {
+        slot = HEAD_ERROR;                  // 每个错误页面只对应一个状态码
+    } else {
+        return nullptr;                     // 206/416 的头部取决于请求的区间
+    }
+    if(encoding_) {
+        slot += HEAD_ENCODED;               // 直接请求预压缩文件时发送的头部不同, 分开保存
+    }
+    // 文件打开或映射失败时由 AddContent_ 生成错误内容
+    if(!file_ || !file_->exists || (code_ != 304 && mmFileStat_.st_size > 0 && !HasBody_())) {
+        return nullptr;
+    }
+    return &file_->Head(slot, [this] {
+        ChainBuffer block;
+        AddStateLine_(block);
+        AddEntityHeader_(block);
+        if(code_ != 304) {
+            block.Append("Content-length: " + to_string(mmFileStat_.st_size) + "\r\n");
+        }
+        return block.RetrieveAllToStr();
+    });
 }
 
 // 获取文件长度
@@ -98,13 +187,56 @@ void HttpResponse::ErrorHtml_() {
     if(CODE_PATH.count(code_) == 1) {
         // 如果有对应状态码的错误页面，则设置路径
         path_ = CODE_PATH.find(code_)->second;
-        // 获取错误页面文件的状态
-        stat((srcDir_ + path_).data(), &mmFileStat_);
+        // 获取错误页面文件及其状态, 客户端接受时发送压缩版本
+        file_ = FileCache::Instance()->Get(path_);
+        if(file_->exists && S_ISREG(file_->st.st_mode) && (file_->st.st_mode & S_IROTH) && file_->st.st_size > 0) {
+            SelectEncoding_();
+        } else {
+            file_ = ErrorBody_(code_, CODE_STATUS.find(code_)->second);   // 错误页面文件不可用时发送生成的页面
+        }
+        mmFileStat_ = file_->st;
     }
 }
 
+// 预先生成错误响应: 读取错误页面并生成头部块, 第一个错误请求不再需要访问文件系统.
+// 错误页面被修改后文件缓存中的条目失效, 下一次请求重新生成一次
+void HttpResponse::WarmErrorPages(const string& srcDir) {
+    for(const auto& page : CODE_PATH) {
+        HttpResponse response;
+        string path = page.second;
+        ChainBuffer buff;
+        response.Init(srcDir, path, false, page.first);
+        response.MakeResponse(buff);
+    }
+}
+
+// 生成的错误页面 (错误页面文件不可用或读取失败时使用), 按状态码和消息只生成一次,
+// 作为内存中的缓存条目在连接间共享, 头部块同样只生成一次
+FileCache::EntryPtr HttpResponse::ErrorBody_(int code, const string& message) {
+    string key = to_string(code) + " " + message;
+    lock_guard<mutex> locker(errorMtx_);
+    auto it = errorBodies_.find(key);
+    if(it != errorBodies_.end()) {
+        return it->second;
+    }
+    auto status = CODE_STATUS.find(code);
+    shared_ptr<FileCache::Entry> entry = make_shared<FileCache::Entry>();
+    entry->buf = "<html><title>Error</title><body bgcolor=\"ffffff\">" + to_string(code) + " : " +
+                 (status != CODE_STATUS.end() ? status->second : "Bad Request") + "\n<p>" + message +
+                 "</p><hr><em>TinyWebServer</em></body></html>";
+    entry->exists = true;
+    entry->st = { 0 };
+    entry->st.st_mode = S_IFREG | 0444;
+    entry->st.st_size = entry->buf.size();
+    entry->fd = -1;
+    entry->mapLen = 0;
+    entry->data = entry->buf.data();
+    errorBodies_[key] = entry;
+    return entry;
+}
+
 // 添加状态行
-void HttpResponse::AddStateLine_(Buffer& buff) {
+void HttpResponse::AddStateLine_(ChainBuffer& buff) {
     string status;
     if(CODE_STATUS.count(code_) == 1) {
         // 获取状态码对应的状态消息
@@ -120,46 +252,329 @@ void HttpResponse::AddStateLine_(Buffer& buff) {
 }
 
 // 添加响应头
-void HttpResponse::AddHeader_(Buffer& buff) {
-    buff.Append("Connection: ");            // 添加Connection头部
+void HttpResponse::AddHeader_(ChainBuffer& buff) {
+    AddConnHeader_(buff);
+    AddEntityHeader_(buff);
+}
+
+// 添加每个响应不同的头部
+void HttpResponse::AddConnHeader_(ChainBuffer& buff) {
     if(isKeepAlive_) {
-        buff.Append("keep-alive\r\n");      // 如果是保持连接，添加keep-alive
-        // 设置keep-alive的参数
-        buff.Append("keep-alive: max=6, timeout=120\r\n"); 
+        // 保持连接, 并设置keep-alive的参数
+        buff.Append("Connection: keep-alive\r\nkeep-alive: max=6, timeout=120\r\n");
     } else {
-        buff.Append("close\r\n");           // 如果不是保持连接，添加close
+        buff.Append("Connection: close\r\n");
+    }
+    buff.Append("Date: ", 6);
+    buff.Append(HttpDate_(), 29);
+    buff.Append("\r\n", 2);
+    if(code_ == 503) {
+        buff.Append("Retry-After: " + to_string(retryAfter) + "\r\n");   // 告诉客户端多久之后重试
+    }
+}
+
+// 添加只取决于文件和状态码的头部
+void HttpResponse::AddEntityHeader_(ChainBuffer& buff) {
+    if(code_ == 200 || code_ == 206 || code_ == 304) {
+        // 缓存验证器: 客户端下次带上 If-None-Match / If-Modified-Since 进行条件请求
+        char date[64];
+        struct tm tm;
+        gmtime_r(&mmFileStat_.st_mtime, &tm);
+        strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        buff.Append("ETag: " + string(etag_) + "\r\n");
+        buff.Append("Last-Modified: " + string(date) + "\r\n");
+    }
+    if(code_ == 200) {
+        buff.Append("Accept-Ranges: bytes\r\n");
+    }
+    if(code_ == 206 && ranges_.size() == 1) {
+        buff.Append("Content-Range: bytes " + to_string(ranges_[0].first) + "-" + to_string(ranges_[0].second)
+                    + "/" + to_string(mmFileStat_.st_size) + "\r\n");
+    }
+    if(code_ == 416) {
+        buff.Append("Content-Range: bytes */" + to_string(mmFileStat_.st_size) + "\r\n");
+    }
+    if(code_ == 405) {
+        buff.Append("Allow: GET, HEAD, POST\r\n");
+    }
+    if(encoding_) {
+        buff.Append("Content-Encoding: " + string(encoding_) + "\r\n");
+    }
+    if(vary_) {
+        buff.Append("Vary: Accept-Encoding\r\n");  // 共享缓存需要按 Accept-Encoding 区分保存
+    }
+    if(code_ == 304) { return; }            // 304 没有响应体, 不需要 Content-type
+    if(code_ == 206 && ranges_.size() > 1) {
+        snprintf(boundary_, sizeof(boundary_), "%020lu", ++boundaryCount_);
+        buff.Append("Content-type: multipart/byteranges; boundary=" + string(boundary_) + "\r\n");
+        return;
     }
     // 添加Content-type头部，根据文件类型设置
     buff.Append("Content-type: " + GetFileType_() + "\r\n"); 
 }
 
-// 添加响应内容
-void HttpResponse::AddContent_(Buffer& buff) {
-    // 打开请求的文件
-    int srcFd = open((srcDir_ + path_).data(), O_RDONLY); 
-    if(srcFd < 0) { 
-        ErrorContent(buff, "File NotFound!"); 
-        return; 
+// 添加响应内容: 文本追加到写缓冲区, 文件内容作为片段追加
+void HttpResponse::AddContent_(ChainBuffer& buff) {
+    if(code_ == 304) {                      // 304 没有响应体
+        buff.Append("\r\n");
+        return;
     }
-    // 将文件映射到内存以提高访问速度
-    LOG_DEBUG("file path %s", (srcDir_ + path_).data());
-    int* mmRet = (int*)mmap(0, mmFileStat_.st_size, PROT_READ, MAP_PRIVATE, srcFd, 0);
-    if(*mmRet == -1) {
+    if(code_ == 416) {                      // 416 没有响应体
+        buff.Append("Content-length: 0\r\n\r\n");
+        return;
+    }
+    if(code_ == 206 && ranges_.size() > 1) {
+        AddMultipart_(buff);
+        return;
+    }
+    off_t first = 0;
+    size_t len = mmFileStat_.st_size;
+    if(code_ == 206) {
+        first = ranges_[0].first;
+        len = ranges_[0].second - first + 1;
+    }
+    // HEAD 请求只返回头部, 不发送文件内容
+    if(!isHead_ && len > 0 && !HasBody_()) {
         ErrorContent(buff, "File NotFound!");
-        return; 
+        return;
     }
-    mmFile_ = (char*)mmRet;                 // 保存映射的地址
-    close(srcFd); // 关闭文件描述符
     // 添加Content-length头部
-    buff.Append("Content-length: " + to_string(mmFileStat_.st_size) + "\r\n\r\n"); 
+    buff.Append("Content-length: " + to_string(len) + "\r\n\r\n"); 
+    if(!isHead_ && len > 0) {
+        AddSpan_(buff, first, len);
+    }
+}
+
+// multipart/byteranges: 每个区间之前是分隔行和该区间的 Content-type/Content-Range, 最后是结束分隔行
+void HttpResponse::AddMultipart_(ChainBuffer& buff) {
+    if(!isHead_ && !HasBody_()) {
+        ErrorContent(buff, "File NotFound!");
+        return;
+    }
+    string type = GetFileType_();
+    vector<string> heads;
+    size_t total = 0;
+    for(const auto& r : ranges_) {
+        heads.push_back("\r\n--" + string(boundary_) + "\r\nContent-type: " + type + "\r\nContent-Range: bytes "
+                        + to_string(r.first) + "-" + to_string(r.second) + "/" + to_string(mmFileStat_.st_size) + "\r\n\r\n");
+        total += heads.back().size() + (r.second - r.first + 1);
+    }
+    string tail = "\r\n--" + string(boundary_) + "--\r\n";
+    total += tail.size();
+    buff.Append("Content-length: " + to_string(total) + "\r\n\r\n");
+    for(size_t i = 0; i < ranges_.size(); i++) {
+        buff.Append(heads[i]);
+        if(!isHead_) {
+            const auto& r = ranges_[i];
+            AddSpan_(buff, r.first, r.second - r.first + 1);
+        }
+    }
+    buff.Append(tail);
+}
+
+// 缓存文件是否已打开或映射 (打开或映射失败时为 false)
+bool HttpResponse::HasBody_() const {
+    return file_ && (file_->data || file_->fd >= 0);
+}
+
+// 追加文件中的一段: 映射在内存中的文件作为引用追加, 较大的文件作为 sendfile 片段; 标记为所属的缓存条目
+void HttpResponse::AddSpan_(ChainBuffer& buff, off_t offset, size_t len) {
+    if(file_->data) {
+        buff.AppendRef(file_->data + offset, len, file_.get());
+    } else {
+        buff.AppendFile(file_->fd, offset, len, file_.get());
+    }
+}
+
+// 解析 Range: "bytes=0-99,200-,-500".
+// 返回 206 (有可满足的区间), 416 (都不可满足), 200 (格式不支持或区间过多, 忽略 Range 返回整个文件)
+int HttpResponse::ParseRange_() {
+    // 解析非负整数
+    auto parseOff = [](string_view str, off_t* val) {
+        if(str.empty() || str.size() > 18) { return false; }
+        *val = 0;
+        for(char ch : str) {
+            if(ch < '0' || ch > '9') { return false; }
+            *val = *val * 10 + (ch - '0');
+        }
+        return true;
+    };
+    ranges_.clear();
+    string_view spec = range_;
+    if(spec.size() < 6 || strncasecmp(spec.data(), "bytes=", 6) != 0) { return 200; }
+    spec.remove_prefix(6);
+    off_t size = mmFileStat_.st_size;
+    while(!spec.empty()) {
+        size_t comma = spec.find(',');
+        string_view item = spec.substr(0, comma);
+        spec = (comma == string_view::npos) ? string_view() : spec.substr(comma + 1);
+        while(!item.empty() && (item.front() == ' ' || item.front() == '\t')) { item.remove_prefix(1); }
+        while(!item.empty() && (item.back() == ' ' || item.back() == '\t')) { item.remove_suffix(1); }
+        if(item.empty()) { continue; }
+        size_t dash = item.find('-');
+        if(dash == string_view::npos) { return 200; }
+        off_t first, last;
+        if(dash == 0) {                     // 后缀区间: 最后 n 个字节
+            off_t n;
+            if(!parseOff(item.substr(1), &n)) { return 200; }
+            first = n >= size ? 0 : size - n;
+            last = size - 1;
+            if(n == 0) { continue; }
+        } else {
+            if(!parseOff(item.substr(0, dash), &first)) { return 200; }
+            if(dash + 1 == item.size()) {   // "first-" 到文件末尾
+                last = size - 1;
+            } else {
+                if(!parseOff(item.substr(dash + 1), &last) || last < first) { return 200; }
+                last = min(last, size - 1);
+            }
+        }
+        if(first >= size || first > last) { continue; }  // 不可满足的区间
+        if(ranges_.size() >= MAX_RANGES) { return 200; }
+        ranges_.push_back({ first, last });
+    }
+    return ranges_.empty() ? 416 : 206;
+}
+
+// If-Range: ETag 使用强比较 (弱 ETag 永不匹配), 日期必须与 Last-Modified 相同; 没有 If-Range 时总是匹配
+bool HttpResponse::IfRangeMatch_() const {
+    if(ifRange_.empty()) { return true; }
+    if(ifRange_.front() == '"') { return ifRange_ == etag_; }
+    if(ifRange_.substr(0, 2) == "W/") { return false; }
+    time_t t;
+    return ParseHttpDate_(ifRange_, &t) && t == mmFileStat_.st_mtime;
+}
+
+// 按 Accept-Encoding 的 q 值选择预压缩的文件: 请求 "/a.css" 时查找 "/a.css.br" 和 "/a.css.gz".
+// 预压缩文件比原文件旧 (原文件修改后没有重新生成) 时不使用; 没有可用的 .gz 文件时交给后台线程即时压缩 (完成前发送原内容), 结果由 GzipCache 缓存.
+// 范围请求和验证器都针对选中的内容
+void HttpResponse::SelectEncoding_() {
+    string::size_type idx = path_.find_last_of('.');
+    if(!file_->exists || idx == string::npos || COMPRESSIBLE.count(path_.substr(idx)) == 0) {
+        return;
+    }
+    vary_ = true;
+    if(acceptEncoding_.empty()) {
+        return;
+    }
+    int qBr, qGzip;
+    ParseAcceptEncoding_(&qBr, &qGzip);
+    // q 值相同时优先 br (压缩率更高)
+    struct { const char* name; const char* suffix; int q; } cands[2] = { { "br", ".br", qBr }, { "gzip", ".gz", qGzip } };
+    if(cands[1].q > cands[0].q) { swap(cands[0], cands[1]); }
+    for(const auto& cand : cands) {
+        if(cand.q <= 0) { continue; }
+        FileCache::EntryPtr variant = FileCache::Instance()->Get(path_ + cand.suffix);
+        if(variant->exists && S_ISREG(variant->st.st_mode) && (variant->st.st_mode & S_IROTH) &&
+           variant->st.st_size > 0 && (variant->data || variant->fd >= 0) && variant->st.st_mtime >= file_->st.st_mtime) {
+            file_ = move(variant);
+            encoding_ = cand.name;
+            return;
+        }
+        if(strcmp(cand.name, "gzip") == 0 && (variant = GzipCache::Instance()->Get(path_, file_))) {
+            file_ = move(variant);
+            encoding_ = cand.name;
+            return;
+        }
+    }
+}
+
+// 解析 "gzip;q=0.8, br, *;q=0.1", q 值换算为 0-1000, 没有列出的编码使用 "*" 的 q 值, 都没有时为 -1
+void HttpResponse::ParseAcceptEncoding_(int* qBr, int* qGzip) const {
+    int qAny = -1;
+    *qBr = *qGzip = -1;
+    string_view str = acceptEncoding_;
+    while(!str.empty()) {
+        size_t comma = str.find(',');
+        string_view item = str.substr(0, comma);
+        str = comma == string_view::npos ? string_view() : str.substr(comma + 1);
+        size_t semi = item.find(';');
+        string_view coding = item.substr(0, semi);
+        while(!coding.empty() && (coding.front() == ' ' || coding.front() == '\t')) { coding.remove_prefix(1); }
+        while(!coding.empty() && (coding.back() == ' ' || coding.back() == '\t')) { coding.remove_suffix(1); }
+        int q = 1000;
+        if(semi != string_view::npos) {
+            string_view param = item.substr(semi + 1);
+            size_t eq = param.find('=');
+            if(eq != string_view::npos) {
+                string_view val = param.substr(eq + 1);
+                while(!val.empty() && val.front() == ' ') { val.remove_prefix(1); }
+                q = (!val.empty() && (val[0] == '0' || val[0] == '1')) ? (val[0] - '0') * 1000 : -1;
+                if(q >= 0 && val.size() > 1 && val[1] == '.') {
+                    int scale = 100;
+                    for(size_t i = 2; i < val.size() && i < 5 && val[i] >= '0' && val[i] <= '9'; i++, scale /= 10) {
+                        q += (val[i] - '0') * scale;
+                    }
+                }
+                q = min(q, 1000);
+            }
+        }
+        if(coding.size() == 2 && strncasecmp(coding.data(), "br", 2) == 0) { *qBr = q; }
+        else if((coding.size() == 4 && strncasecmp(coding.data(), "gzip", 4) == 0) ||
+                (coding.size() == 6 && strncasecmp(coding.data(), "x-gzip", 6) == 0)) { *qGzip = q; }
+        else if(coding == "*") { qAny = q; }
+    }
+    if(*qBr < 0) { *qBr = qAny; }
+    if(*qGzip < 0) { *qGzip = qAny; }
+}
+
+// 条件请求: If-None-Match 优先, 没有时才检查 If-Modified-Since
+bool HttpResponse::NotModified_() {
+    if(!ifNoneMatch_.empty()) {
+        return ETagMatch_(ifNoneMatch_);
+    }
+    time_t since;
+    if(!ifModifiedSince_.empty() && ParseHttpDate_(ifModifiedSince_, &since)) {
+        return mmFileStat_.st_mtime <= since;
+    }
+    return false;
 }
 
-// 解除文件映射
-void HttpResponse::UnmapFile() {
-    if(mmFile_) {
-        munmap(mmFile_, mmFileStat_.st_size); 
-        mmFile_ = nullptr;
+// If-None-Match: "*" 或逗号分隔的 ETag 列表, 使用弱比较 (忽略 W/ 前缀)
+bool HttpResponse::ETagMatch_(string_view tags) const {
+    string_view etag(etag_);
+    while(!tags.empty()) {
+        size_t comma = tags.find(',');
+        string_view tag = tags.substr(0, comma);
+        tags = (comma == string_view::npos) ? string_view() : tags.substr(comma + 1);
+        while(!tag.empty() && (tag.front() == ' ' || tag.front() == '\t')) { tag.remove_prefix(1); }
+        while(!tag.empty() && (tag.back() == ' ' || tag.back() == '\t')) { tag.remove_suffix(1); }
+        if(tag.substr(0, 2) == "W/") { tag.remove_prefix(2); }
+        if(tag == "*" || tag == etag) { return true; }
     }
+    return false;
+}
+
+// 解析 HTTP 日期 (IMF-fixdate, 如 "Sun, 06 Nov 1994 08:49:37 GMT"), 不支持的格式返回 false
+bool HttpResponse::ParseHttpDate_(string_view str, time_t* t) {
+    char buf[64];
+    if(str.size() >= sizeof(buf)) { return false; }
+    memcpy(buf, str.data(), str.size());
+    buf[str.size()] = '\0';
+    struct tm tm = {};
+    const char* end = strptime(buf, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    if(!end || *end != '\0') { return false; }
+    *t = timegm(&tm);
+    return true;
+}
+
+// 释放对缓存文件的引用 (条目已被淘汰时由此解除映射、关闭文件)
+void HttpResponse::ReleaseFile() {
+    file_.reset();
+}
+
+// 当前时间的 HTTP 日期 (固定 29 个字符), 每个线程每秒只格式化一次
+const char* HttpResponse::HttpDate_() {
+    thread_local time_t last = 0;
+    thread_local char date[32];
+    time_t now = time(nullptr);
+    if(now != last) {
+        struct tm tm;
+        gmtime_r(&now, &tm);
+        strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        last = now;
+    }
+    return date;
 }
 
 // 获取响应的文件类型
@@ -177,25 +592,21 @@ string HttpResponse::GetFileType_() {
     return "text/plain";                    // 如果后缀未知，返回"text/plain"
 }
 
-// 生成错误内容
-void HttpResponse::ErrorContent(Buffer& buff, string message) {
-    string body;                            // 错误页面的HTML内容
-    string status;
-    // 构建HTML页面
-    body += "<html><title>Error</title>";
-    body += "<body bgcolor=\"ffffff\">";
-    // 获取并显示状态消息
-    if(CODE_STATUS.count(code_) == 1) {
-        status = CODE_STATUS.find(code_)->second;
-    } else {
-        status = "Bad Request";
+// 生成错误内容 (文件打开或映射失败时), 页面按状态码和消息缓存, 不再每次拼接
+void HttpResponse::ErrorContent(ChainBuffer& buff, string message) {
+    FileCache::EntryPtr body = ErrorBody_(code_, message);
+    // 客户端接受 gzip 且页面足够大时发送压缩结果 (按状态码和消息缓存)
+    int qBr, qGzip;
+    ParseAcceptEncoding_(&qBr, &qGzip);
+    FileCache::EntryPtr gz;
+    if(qGzip > 0 && (gz = GzipCache::Instance()->Get("#" + to_string(code_) + message, body->buf))) {
+        buff.Append("Content-Encoding: gzip\r\n");
+        if(!vary_) { buff.Append("Vary: Accept-Encoding\r\n"); }
+        body = move(gz);
+    }
+    buff.Append("Content-length: " + to_string(body->st.st_size) + "\r\n\r\n");
+    file_ = move(body);
+    if(!isHead_) {
+        AddSpan_(buff, 0, file_->st.st_size);
     }
-    body += to_string(code_) + " : " + status  + "\n";
-    body += "<p>" + message + "</p>";
-    body += "<hr><em>TinyWebServer</em></body></html>";
-
-    // 将错误页面的内容长度添加到响应头部
-    buff.Append("Content-length: " + to_string(body.size()) + "\r\n\r\n");
-    // 将错误页面的HTML内容添加到响应缓冲区
-    buff.Append(body); 
 }
\ No newline at end of file
@@ -2,43 +2,85 @@
 #define HTTP_RESPONSE_H
 
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <atomic>
+#include <strings.h>                                        // strncasecmp
 #include <fcntl.h>                                          // 文件控制，例如 open
 #include <unistd.h>                                         // UNIX标准符号常量和类型，例如 close
 #include <sys/stat.h>                                       // 文件状态信息，例如 stat
 #include <sys/mman.h>                                       // 内存管理声明，例如 mmap, munmap
+#include <time.h>                                           // gmtime_r, strptime, timegm
+#include <string_view>
 
-#include "../buffer/buffer.h"
+#include "../buffer/chainbuffer.h"
 #include "../log/log.h"
+#include "httprequest.h"
+#include "filecache.h"
+#include "gzipcache.h"
 
 // HttpResponse 类，用于处理HTTP响应
 class HttpResponse {
 public:
     HttpResponse();                                         // 构造函数
     ~HttpResponse();                                        // 析构函数
-    // 初始化响应
-    void Init(const std::string& srcDir, std::string& path, bool isKeepAlive = false, int code = -1);
-    void MakeResponse(Buffer& buff);                        // 构造响应
-    void UnmapFile();                                       // 解除文件映射
-    char* File();                                           // 获取文件地址
+    // 初始化响应; request 用于读取 HEAD 方法和条件请求头, 只在随后的 MakeResponse 中使用
+    void Init(const std::string& srcDir, std::string& path, bool isKeepAlive = false, int code = -1,
+              const HttpRequest* request = nullptr);
+    // 构造响应: 文本追加到写缓冲区, 文件内容和头部块作为引用追加 (不复制), 缓存文件由写缓冲区保持到发送完成.
+    // 文件内容片段的标记为所属的缓存条目 (FileCache::Entry), 头部块没有标记
+    void MakeResponse(ChainBuffer& buff);
+    void ReleaseFile();                                     // 释放对缓存文件的引用
     size_t FileLen() const;                                 // 获取文件长度
-    void ErrorContent(Buffer& buff, std::string message);   // 生成错误内容
+    void ErrorContent(ChainBuffer& buff, std::string message);  // 生成错误内容
     int Code() const { return code_; }                      // 获取响应码
+    bool IsKeepAlive() const { return isKeepAlive_; }       // 响应后是否保持连接
+
+    static void WarmErrorPages(const std::string& srcDir);  // 预先生成各错误响应的头部块和页面 (启动时调用)
+
+    static int retryAfter;                                  // 503 响应中 Retry-After 的秒数
 
 private:
-    void AddStateLine_(Buffer &buff);                       // 添加响应行
-    void AddHeader_(Buffer &buff);                          // 添加响应头
-    void AddContent_(Buffer &buff);                         // 添加响应体
+    void AddStateLine_(ChainBuffer& buff);                  // 添加响应行
+    void AddHeader_(ChainBuffer& buff);                     // 添加响应头
+    void AddConnHeader_(ChainBuffer& buff);                 // 添加每个响应不同的头部 (Connection, Date 等)
+    void AddEntityHeader_(ChainBuffer& buff);               // 添加只取决于文件和状态码的头部
+    const std::string* HeadBlock_();                        // 缓存条目中预先生成的头部块, 不能使用时为 nullptr
+    void AddContent_(ChainBuffer& buff);                    // 添加响应体
 
     void ErrorHtml_();                                      // 生成错误页面
+    static FileCache::EntryPtr ErrorBody_(int code, const std::string& message);  // 生成的错误页面 (按状态码和消息缓存)
+    void SelectEncoding_();                                 // 按 Accept-Encoding 选择预压缩的文件 (.br/.gz) 或即时压缩
+    void ParseAcceptEncoding_(int* qBr, int* qGzip) const;  // 解析 Accept-Encoding 中 br 和 gzip 的 q 值
+    bool NotModified_();                                    // 条件请求的验证器是否匹配 (返回 304)
+    int ParseRange_();                                      // 解析 Range, 返回 206, 416 或 200 (忽略 Range)
+    bool IfRangeMatch_() const;                             // If-Range 是否与当前文件匹配
+    void AddMultipart_(ChainBuffer& buff);                  // 添加 multipart/byteranges 响应体
+    bool HasBody_() const;                                  // 缓存文件是否已打开或映射, 可以发送内容
+    void AddSpan_(ChainBuffer& buff, off_t offset, size_t len);  // 追加文件中的一段 (映射的内容或 sendfile 片段)
+    bool ETagMatch_(std::string_view tags) const;           // If-None-Match 中是否有匹配的 ETag
+    static bool ParseHttpDate_(std::string_view str, time_t* t);  // 解析 HTTP 日期
+    static const char* HttpDate_();                         // 当前时间的 HTTP 日期
     std::string GetFileType_();                             // 获取文件类型
 
     int code_;                                              // HTTP响应码
     bool isKeepAlive_;                                      // 是否保持连接
+    bool isHead_;                                           // 是否为 HEAD 请求 (只返回头部)
+    std::string_view ifNoneMatch_;                          // 请求中的 If-None-Match
+    std::string_view ifModifiedSince_;                      // 请求中的 If-Modified-Since
+    std::string_view range_;                                // 请求中的 Range
+    std::string_view ifRange_;                              // 请求中的 If-Range
+    std::string_view acceptEncoding_;                       // 请求中的 Accept-Encoding
+    const char* encoding_;                                  // 发送的压缩内容的编码, 没有时为 nullptr
+    bool vary_;                                             // 响应是否随 Accept-Encoding 变化 (可压缩的文件类型)
+    std::vector<std::pair<off_t, off_t>> ranges_;           // 请求的字节区间 [first, last]
+    char boundary_[24];                                     // multipart/byteranges 的分隔符
+    char etag_[64];                                         // 文件的 ETag, 由 inode、修改时间和大小生成
 
     std::string path_;                                      // 请求路径
     std::string srcDir_;                                    // 源文件目录
     
-    char* mmFile_;                                          // 内存映射的文件数据
+    FileCache::EntryPtr file_;                              // 缓存中的文件 (映射或打开的文件描述符)
     struct stat mmFileStat_;                                // 文件状态信息
     // 文件后缀到MIME类型的映射
     static const std::unordered_map<std::string, std::string> SUFFIX_TYPE;
@@ -46,6 +88,14 @@ private:
     static const std::unordered_map<int, std::string> CODE_STATUS;
     // 状态码到错误页面路径的映射
     static const std::unordered_map<int, std::string> CODE_PATH;
+    // 可以压缩的文件后缀 (文本、脚本、样式和字体), 即允许压缩的 MIME 类型
+    static const std::unordered_set<std::string> COMPRESSIBLE;
+    static const size_t MAX_RANGES = 16;                    // 一个请求最多的区间数, 超出时返回整个文件
+    // 缓存条目中头部块的位置: 200, 304, 错误页面; 作为压缩版本发送时位置再加上 HEAD_ENCODED
+    enum HEAD_SLOT { HEAD_OK, HEAD_NOT_MODIFIED, HEAD_ERROR, HEAD_ENCODED };
+    static std::atomic<unsigned long> boundaryCount_;       // 用于生成分隔符
+    static std::unordered_map<std::string, FileCache::EntryPtr> errorBodies_;   // 生成的错误页面
+    static std::mutex errorMtx_;                            // 保护 errorBodies_
 };
 
 #endif //HTTP_RESPONSE_H
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include "httpscan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HTTP_SCAN_X86
+#endif
+
+// tchar = "!" / "#" / "$" / "%" / "&" / "'" / "*" / "+" / "-" / "." / "^" / "_" / "`" / "|" / "~" / DIGIT / ALPHA
+const std::array<bool, 256> HttpScan::TOKEN_TABLE = [] {
+    std::array<bool, 256> table{};
+    for(int ch = '0'; ch <= '9'; ch++) { table[ch] = true; }
+    for(int ch = 'A'; ch <= 'Z'; ch++) { table[ch] = true; }
+    for(int ch = 'a'; ch <= 'z'; ch++) { table[ch] = true; }
+    for(const char* p = "!#$%&'*+-.^_`|~"; *p; p++) { table[static_cast<unsigned char>(*p)] = true; }
+    return table;
+}();
+
+// 标量实现, 也用于 SIMD 实现处理不足一个向量的尾部
+static const char* FindCharScalar(const char* begin, const char* end, char ch) {
+    while(begin < end && *begin != ch) { begin++; }
+    return begin;
+}
+
+static const char* FindTokenEndScalar(const char* begin, const char* end) {
+    while(begin < end && HttpScan::IsTokenChar(static_cast<unsigned char>(*begin))) { begin++; }
+    return begin;
+}
+
+#ifdef HTTP_SCAN_X86
+// 不足一个向量的尾部: 区间总长度够一个向量时, 改为从 end 向前对齐读取 (与已扫描部分重叠),
+// 屏蔽 begin 之前的位, 避免退回逐字节比较; 也不会读到 end 之后的内存
+
+// SSE: 一次比较 16 字节, 用 movemask 取出匹配位
+__attribute__((target("sse4.2")))
+static const char* FindCharSse42(const char* begin, const char* end, char ch) {
+    if(end - begin < 16) { return FindCharScalar(begin, end, ch); }
+    const __m128i needle = _mm_set1_epi8(ch);
+    for(; end - begin >= 16; begin += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+        if(mask) { return begin + __builtin_ctz(mask); }
+    }
+    if(begin == end) { return end; }
+    const char* last = end - 16;
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(last));
+    unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)) >> (begin - last);
+    return mask ? begin + __builtin_ctz(mask) : end;
+}
+
+// AVX2: 一次比较 32 字节
+__attribute__((target("avx2")))
+static const char* FindCharAvx2(const char* begin, const char* end, char ch) {
+    if(end - begin < 32) { return FindCharSse42(begin, end, ch); }
+    const __m256i needle = _mm256_set1_epi8(ch);
+    for(; end - begin >= 32; begin += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)));
+        if(mask) { return begin + __builtin_ctz(mask); }
+    }
+    if(begin == end) { return end; }
+    const char* last = end - 32;
+    __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(last));
+    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle))) >> (begin - last);
+    return mask ? begin + __builtin_ctz(mask) : end;
+}
+
+// 16 字节中不是 token 字符的位掩码.
+// SSE4.2 pcmpestrm 的区间比较一条指令判断 16 个字节是否落在合法区间内;
+// 一个寄存器最多放 8 个区间, '~' 放不下, 单独比较后从结果中去掉
+__attribute__((target("sse4.2")))
+static inline unsigned NonTokenMask(__m128i chunk) {
+    const __m128i ranges = _mm_setr_epi8(
+        '!', '!', '#', '\'', '*', '+', '-', '.', '0', '9', 'A', 'Z', '^', 'z', '|', '|');
+    __m128i bits = _mm_cmpestrm(ranges, 16, chunk, 16,
+                    _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_NEGATIVE_POLARITY | _SIDD_BIT_MASK);
+    unsigned tilde = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('~')));
+    return static_cast<unsigned>(_mm_cvtsi128_si32(bits)) & ~tilde & 0xFFFF;
+}
+
+__attribute__((target("sse4.2")))
+static const char* FindTokenEndSse42(const char* begin, const char* end) {
+    if(end - begin < 16) { return FindTokenEndScalar(begin, end); }
+    for(; end - begin >= 16; begin += 16) {
+        unsigned mask = NonTokenMask(_mm_loadu_si128(reinterpret_cast<const __m128i*>(begin)));
+        if(mask) { return begin + __builtin_ctz(mask); }
+    }
+    if(begin == end) { return end; }
+    const char* last = end - 16;
+    unsigned mask = NonTokenMask(_mm_loadu_si128(reinterpret_cast<const __m128i*>(last))) >> (begin - last);
+    return mask ? begin + __builtin_ctz(mask) : end;
+}
+#endif
+
+// 检测 CPU 支持的指令集: 2 为 AVX2, 1 为 SSE4.2, 0 为标量
+static int DetectIsa() {
+#ifdef HTTP_SCAN_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) { return 2; }
+    if(__builtin_cpu_supports("sse4.2")) { return 1; }
+#endif
+    return 0;
+}
+
+static const int ISA_LEVEL = DetectIsa();
+
+#ifdef HTTP_SCAN_X86
+HttpScan::FindCharFn HttpScan::findChar_ =
+    ISA_LEVEL == 2 ? FindCharAvx2 : (ISA_LEVEL == 1 ? FindCharSse42 : FindCharScalar);
+HttpScan::FindTokenEndFn HttpScan::findTokenEnd_ = ISA_LEVEL >= 1 ? FindTokenEndSse42 : FindTokenEndScalar;
+#else
+HttpScan::FindCharFn HttpScan::findChar_ = FindCharScalar;
+HttpScan::FindTokenEndFn HttpScan::findTokenEnd_ = FindTokenEndScalar;
+#endif
+
+const char* HttpScan::Isa() {
+    static const char* NAMES[] = { "scalar", "sse4.2", "avx2" };
+    return NAMES[ISA_LEVEL];
+}
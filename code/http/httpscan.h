@@ -0,0 +1,33 @@
+#ifndef HTTP_SCAN_H
+#define HTTP_SCAN_H
+
+#include <cstddef>
+#include <array>
+
+// HTTP 报文分隔符扫描, 一次比较 16/32 字节
+// 启动时根据 CPUID 选择 AVX2 / SSE4.2 实现, 不支持时使用逐字节的标量实现
+class HttpScan {
+public:
+    // 返回 [begin, end) 中第一个等于 ch 的位置, 没有时返回 end
+    static const char* FindChar(const char* begin, const char* end, char ch) {
+        return findChar_(begin, end, ch);
+    }
+    // 返回 [begin, end) 中第一个不是 token 字符 (RFC 7230 tchar) 的位置, 没有时返回 end
+    // 用于在校验方法名/头部名称的同时找到其后的 ' ' 或 ':'
+    static const char* FindTokenEnd(const char* begin, const char* end) {
+        return findTokenEnd_(begin, end);
+    }
+    static const char* Isa();                       // 当前使用的指令集, 用于日志
+
+    static bool IsTokenChar(unsigned char ch) { return TOKEN_TABLE[ch]; }  // 是否为 token 字符
+
+private:
+    typedef const char* (*FindCharFn)(const char*, const char*, char);
+    typedef const char* (*FindTokenEndFn)(const char*, const char*);
+
+    static const std::array<bool, 256> TOKEN_TABLE; // tchar 查找表
+    static FindCharFn findChar_;
+    static FindTokenEndFn findTokenEnd_;
+};
+
+#endif //HTTP_SCAN_H
@@ -126,6 +126,7 @@ void Log::write(int level, const char *format, ...) {
     {
         unique_lock<mutex> locker(mtx_);    // 加锁
         lineCount_++;                       // 增加行数计数
+        buff_.EnsureWriteable(128);
         int n = snprintf(buff_.BeginWrite(), 128, "%d-%02d-%02d %02d:%02d:%02d.%06ld ",
                     t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
                     t.tm_hour, t.tm_min, t.tm_sec, now.tv_usec);
@@ -136,18 +137,30 @@ void Log::write(int level, const char *format, ...) {
         va_start(vaList, format);           // 开始处理可变参数
         int m = vsnprintf(buff_.BeginWrite(), buff_.WritableBytes(), format, vaList);
         va_end(vaList);                     // 结束处理可变参数
+        if(m >= int(buff_.WritableBytes())) {
+            // 当前 slab 放不下: 在新的 slab 中重新格式化, 超过一个 slab 的部分截断
+            buff_.EnsureWriteable(min(size_t(m) + 1, ChainBuffer::MAX_WRITABLE));
+            va_start(vaList, format);
+            m = vsnprintf(buff_.BeginWrite(), buff_.WritableBytes(), format, vaList);
+            va_end(vaList);
+            m = min(m, int(buff_.WritableBytes()) - 1);
+        }
 
-        buff_.HasWritten(m);                // 更新缓冲区写入位置
-        buff_.Append("\n\0", 2);            // 添加换行和字符串结束符
+        buff_.HasWritten(max(m, 0));        // 更新缓冲区写入位置
+        buff_.Append("\n", 1);              // 添加换行
 
         if(isAsync_ && deque_ && !deque_->full()) {
             // 如果是异步模式且队列未满，则将日志信息添加到队列中
             deque_->push_back(buff_.RetrieveAllToStr());
         } else {
-            // 否则直接写入文件
-            fputs(buff_.Peek(), fp_);
+            // 否则直接写入文件 (一行可能分布在几个 slab 中)
+            struct iovec iov[4];
+            int cnt = buff_.PeekIov(iov, nullptr, 4);
+            for(int i = 0; i < cnt; i++) {
+                fwrite(iov[i].iov_base, 1, iov[i].iov_len, fp_);
+            }
         }
-        buff_.RetrieveAll();                        // 清空缓冲区
+        buff_.RetrieveAll();                        // 清空缓冲区, 归还 slab
     }
 }
 
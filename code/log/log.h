@@ -10,7 +10,7 @@
 #include <assert.h>
 #include <sys/stat.h>
 #include "blockqueue.h"
-#include "../buffer/buffer.h"
+#include "../buffer/chainbuffer.h"
 
 // Log 类
 class Log {
@@ -51,7 +51,7 @@ private:
     int lineCount_;                         // 当前行数和日期
     int toDay_;
     bool isOpen_;                           // 是否开启日志系统
-    Buffer buff_;                           // 缓冲区
+    ChainBuffer buff_;                      // 缓冲区 (格式化一行日志, 放不下时接到新的 slab 中)
     int level_;                             // 日志等级
     bool isAsync_;                          // 是否异步
 
@@ -2,8 +2,9 @@
 #include "server/webserver.h"
 
 int main() {
-    // 服务器初始化 (port, ET, timeout, optLinger, sqlPort, user, passwd, sqlName, sqlNum, threadNum, Log, LogLevel, LogQueSize)
-    WebServer server(1316, 3, 60000, false, 3306, "root", "Xch990705", "webserver", 12, 6, true, 1, 1024);
+    ServerOpt opt;                          // 调优参数, 各字段的默认值见 webserver.h
+    // 服务器初始化 (port, ET, timeout, optLinger, sqlPort, user, passwd, sqlName, sqlNum, threadNum, Log, LogLevel, LogQueSize, reactorNum, ioUring, inlineIO, opt)
+    WebServer server(1316, 3, 60000, false, 3306, "root", "Xch990705", "webserver", 12, 6, true, 1, 1024, 0, false, false, opt);
 
     // 服务器启动
     server.Start();
@@ -59,6 +59,12 @@ public:
         pool_->cond.notify_one();                       // 通知一个等待的线程
     }
 
+    // 获取等待执行的任务数
+    size_t TaskCount() {
+        std::lock_guard<std::mutex> locker(pool_->mtx);
+        return pool_->tasks.size();
+    }
+
 private:
     // 线程池
     struct Pool {
@@ -0,0 +1,34 @@
+#include "conntable.h"
+
+// 构造函数 (只分配块指针数组, 槽位按需分块分配)
+ConnTable::ConnTable(int maxFd): maxFd_(maxFd), chunkNum_((maxFd + CHUNK_SIZE - 1) / CHUNK_SIZE),
+                                 chunks_(new std::atomic<Slot*>[chunkNum_]) {
+    assert(maxFd > 0);
+    for(int i = 0; i < chunkNum_; i++) {
+        chunks_[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+// 析构函数, 释放所有块
+ConnTable::~ConnTable() {
+    for(int i = 0; i < chunkNum_; i++) {
+        delete[] chunks_[i].load(std::memory_order_relaxed);
+    }
+}
+
+// 获取 fd 对应的槽位
+ConnTable::Slot* ConnTable::Acquire(int fd) {
+    if(fd < 0 || fd >= maxFd_) { return nullptr; }
+    std::atomic<Slot*>& chunk = chunks_[fd / CHUNK_SIZE];
+    Slot* slots = chunk.load(std::memory_order_acquire);
+    if(!slots) {
+        std::lock_guard<std::mutex> locker(mtx_);  // 加锁, 防止多个反应堆同时分配同一块
+        slots = chunk.load(std::memory_order_relaxed);
+        if(!slots) {
+            slots = new Slot[CHUNK_SIZE];
+            chunk.store(slots, std::memory_order_release);
+        }
+    }
+    return &slots[fd % CHUNK_SIZE];
+}
+
@@ -0,0 +1,34 @@
+#ifndef CONN_TABLE_H
+#define CONN_TABLE_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <assert.h>
+#include "../http/httpconn.h"
+
+// 连接表: 以 fd 为下标, 按块预分配的连接槽位
+// 块一旦分配就不再移动或释放, 所以槽位地址在进程生命周期内保持不变, 可以直接放入 epoll_event.data.ptr
+class ConnTable {
+public:
+    // 连接槽位
+    struct Slot {
+        HttpConn conn;                              // 连接对象
+        std::atomic<uint32_t> gen{0};               // 代数, 连接建立和关闭时各加一, 用于识别过期的回调 (定时器, 投递的重新注册)
+    };
+
+    explicit ConnTable(int maxFd);                  // 构造函数, maxFd 为可容纳的最大 fd
+    ~ConnTable();                                   // 析构函数
+
+    Slot* Acquire(int fd);                          // 获取 fd 对应的槽位, 所在块未分配时先分配
+
+private:
+    static const int CHUNK_SIZE = 1024;             // 每块的槽位数
+
+    int maxFd_;                                     // 最大 fd
+    int chunkNum_;                                  // 块数
+    std::unique_ptr<std::atomic<Slot*>[]> chunks_;  // 块指针数组, 大小固定, 读取无需加锁
+    std::mutex mtx_;                                // 互斥锁, 只在分配新块时使用
+};
+
+#endif //CONN_TABLE_H
@@ -1,42 +1,97 @@
 #include "epoller.h"
 
-// 构造函数 (调用 epoll_create 创建一个 epoll 实例)
-Epoller::Epoller(int maxEvent):epollFd_(epoll_create(512)), events_(maxEvent){
-    assert(epollFd_ >= 0 && events_.size() > 0);
+#ifdef USE_IO_URING
+// user_data 的最高位标记内部的撤销请求, 其完成事件直接丢弃
+static const uint64_t URING_CANCEL_TAG = 1ULL << 63;
+
+// 请求类型, 记录在 user_data 中
+enum : uint8_t {
+    URING_POLL,                                     // 就绪通知
+    URING_ACCEPT,                                   // multishot accept
+    URING_RECV,                                     // recv
+    URING_SEND,                                     // sendmsg
+};
+
+// 由 fd, 注册序号和请求类型拼出请求的 user_data
+static uint64_t UringUserData(int fd, uint16_t seq, uint8_t op) {
+    return (static_cast<uint64_t>(op) << 48) | (static_cast<uint64_t>(seq) << 32) | static_cast<uint32_t>(fd);
+}
+#endif
+
+// 构造函数 (优先初始化 io_uring, 不可用时调用 epoll_create 创建一个 epoll 实例)
+Epoller::Epoller(int maxEvent, bool useUring):epollFd_(-1), events_(maxEvent), results_(maxEvent){
+    assert(events_.size() > 0);
+#ifdef USE_IO_URING
+    if(useUring && InitUring_()) { return; }
+#endif
+    epollFd_ = epoll_create(512);
+    assert(epollFd_ >= 0);
 }
 
 // 析构函数
 Epoller::~Epoller() {
-    close(epollFd_);
+#ifdef USE_IO_URING
+    if(recvRing_) { io_uring_free_buf_ring(ring_.get(), recvRing_, RECV_BUFS, RECV_GROUP); }
+    if(ring_) { io_uring_queue_exit(ring_.get()); }
+#endif
+    if(epollFd_ >= 0) { close(epollFd_); }
 }
 
 // 添加 fd 到 epoll 实例中
 bool Epoller::AddFd(int fd, uint32_t events) {
-    if(fd < 0) return false;
-    epoll_event ev = {0};                                       // 创建 epoll_event 结构体
-    ev.data.fd = fd;                                            // 设置文件描述符
-    ev.events = events;                                         // 设置事件类型
-    return 0 == epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev);    // 向 epoll 实例添加 fd
+    epoll_data_t data = {0};
+    data.fd = fd;                                               // 设置文件描述符
+    return Ctl_(EPOLL_CTL_ADD, fd, events, data);               // 向 epoll 实例添加 fd
+}
+
+// 添加 fd 到 epoll 实例中, 事件发生时通过 GetEventPtr 取回 ptr
+bool Epoller::AddFd(int fd, uint32_t events, void* ptr) {
+    epoll_data_t data = {0};
+    data.ptr = ptr;                                             // 设置事件携带的指针
+    return Ctl_(EPOLL_CTL_ADD, fd, events, data);
 }
 
 // 修改 fd 到 epoll 实例中
 bool Epoller::ModFd(int fd, uint32_t events) {
-    if(fd < 0) return false;
-    epoll_event ev = {0};                                       // 创建 epoll_event 结构体
-    ev.data.fd = fd;                                            // 设置文件描述符
-    ev.events = events;                                         // 设置事件类型
-    return 0 == epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &ev);    // 向 epoll 实例修改 fd
+    epoll_data_t data = {0};
+    data.fd = fd;
+    return Ctl_(EPOLL_CTL_MOD, fd, events, data);               // 向 epoll 实例修改 fd
+}
+
+// 修改 fd 到 epoll 实例中, 事件携带指针 ptr
+bool Epoller::ModFd(int fd, uint32_t events, void* ptr) {
+    epoll_data_t data = {0};
+    data.ptr = ptr;
+    return Ctl_(EPOLL_CTL_MOD, fd, events, data);
+}
+
+// 删除 fd 于 epoll 实例中, draining 不为空时等待尚未完成的 sendmsg 结束
+bool Epoller::DelFd(int fd, bool* draining) {
+    epoll_data_t data = {0};
+    if(draining) { *draining = false; }
+#ifdef USE_IO_URING
+    if(ring_ && fd >= 0) { return UringCtl_(EPOLL_CTL_DEL, fd, 0, data, false, draining); }
+#endif
+    return Ctl_(EPOLL_CTL_DEL, fd, 0, data);
 }
 
-// 删除 fd 于 epoll 实例中
-bool Epoller::DelFd(int fd) {
+// 执行 epoll_ctl 操作
+bool Epoller::Ctl_(int op, int fd, uint32_t events, epoll_data_t data) {
     if(fd < 0) return false;
-    epoll_event ev = {0};
-    return 0 == epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, &ev);
+#ifdef USE_IO_URING
+    if(ring_) { return UringCtl_(op, fd, events, data); }
+#endif
+    epoll_event ev = {0};                                       // 创建 epoll_event 结构体
+    ev.data = data;                                             // 设置文件描述符或指针
+    ev.events = events;                                         // 设置事件类型
+    return 0 == epoll_ctl(epollFd_, op, fd, &ev);
 }
 
 // 等待事件发生, 并返回发生的事件数量
 int Epoller::Wait(int timeoutMs) {
+#ifdef USE_IO_URING
+    if(ring_) { return UringWait_(timeoutMs); }
+#endif
     return epoll_wait(epollFd_, &events_[0], static_cast<int>(events_.size()), timeoutMs);
 }
 
@@ -46,8 +101,319 @@ int Epoller::GetEventFd(size_t i) const {
     return events_[i].data.fd;
 }
 
+// 获取第 i 个事件携带的指针
+void* Epoller::GetEventPtr(size_t i) const {
+    assert(i < events_.size() && i >= 0);
+    return events_[i].data.ptr;
+}
+
 // 获取第 i 个事件的类型
 uint32_t Epoller::GetEvents(size_t i) const {
     assert(i < events_.size() && i >= 0);
     return events_[i].events;
-}
\ No newline at end of file
+}
+
+// 当前使用的后端名称
+const char* Epoller::Backend() const {
+#ifdef USE_IO_URING
+    if(ring_) { return "io_uring"; }
+#endif
+    return "epoll";
+}
+
+// 是否支持完成式操作 (io_uring 后端)
+bool Epoller::HasCompletion() const {
+#ifdef USE_IO_URING
+    if(ring_) { return true; }
+#endif
+    return false;
+}
+
+// 添加监听 fd, io_uring 后端可读时用 multishot accept 直接接受连接
+bool Epoller::AddAcceptFd(int fd, uint32_t events, void* ptr) {
+    epoll_data_t data = {0};
+    data.ptr = ptr;
+#ifdef USE_IO_URING
+    if(ring_ && fd >= 0) { return UringCtl_(EPOLL_CTL_ADD, fd, events, data, true); }
+#endif
+    return Ctl_(EPOLL_CTL_ADD, fd, events, data);
+}
+
+// 提交 recv, 数据读入内核从共享缓冲区环中选取的缓冲区
+bool Epoller::SubmitRecv(int fd, void* ptr) {
+#ifdef USE_IO_URING
+    if(ring_ && recvRing_) {
+        std::lock_guard<std::mutex> locker(mtx_);
+        UringReg_* reg = UringIoReg_(fd, ptr);
+        if(reg) {
+            struct io_uring_sqe* sqe = UringSqe_();
+            io_uring_prep_recv(sqe, fd, nullptr, RECV_BUF_SIZE, 0);
+            sqe->flags |= IOSQE_BUFFER_SELECT;
+            sqe->buf_group = RECV_GROUP;
+            UringSubmitted_(fd, *reg, URING_RECV, sqe);
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
+// 提交 sendmsg
+bool Epoller::SubmitSend(int fd, const struct msghdr* msg, int flags, void* ptr) {
+#ifdef USE_IO_URING
+    if(ring_) {
+        std::lock_guard<std::mutex> locker(mtx_);
+        UringReg_* reg = UringIoReg_(fd, ptr);
+        if(reg) {
+            struct io_uring_sqe* sqe = UringSqe_();
+            io_uring_prep_sendmsg(sqe, fd, msg, flags);
+            UringSubmitted_(fd, *reg, URING_SEND, sqe);
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
+// 第 i 个事件是否为完成事件
+bool Epoller::IsCompletion(size_t i) const {
+    assert(i < results_.size() && i >= 0);
+    return results_[i].completed;
+}
+
+// 第 i 个完成事件的结果
+int Epoller::GetResult(size_t i) const {
+    assert(i < results_.size() && i >= 0);
+    return results_[i].res;
+}
+
+// 第 i 个 recv 完成事件读到的数据
+const char* Epoller::GetRecvBuf(size_t i) const {
+    assert(i < results_.size() && i >= 0);
+    return results_[i].buf;
+}
+
+#ifdef USE_IO_URING
+// 初始化 io_uring, 内核不支持或不支持带超时的等待 (IORING_FEAT_EXT_ARG, 5.11+) 时返回 false
+bool Epoller::InitUring_() {
+    ring_.reset(new io_uring());
+    if(io_uring_queue_init(static_cast<unsigned>(events_.size()), ring_.get(), 0) < 0) {
+        ring_.reset();
+        return false;
+    }
+    if(!(ring_->features & IORING_FEAT_EXT_ARG)) {
+        io_uring_queue_exit(ring_.get());
+        ring_.reset();
+        return false;
+    }
+    InitRecvRing_();                                // 不支持共享缓冲区环时, 连接的读取仍用就绪通知
+    return true;
+}
+
+// 注册 recv 的共享缓冲区环: 等待中的 recv 不占用缓冲区, 数据到达时内核才从环中取一个
+bool Epoller::InitRecvRing_() {
+    int err = 0;
+    recvRing_ = io_uring_setup_buf_ring(ring_.get(), RECV_BUFS, RECV_GROUP, 0, &err);
+    if(!recvRing_) { return false; }
+    recvMem_.reset(new char[RECV_BUFS * RECV_BUF_SIZE]);
+    for(unsigned i = 0; i < RECV_BUFS; i++) {
+        io_uring_buf_ring_add(recvRing_, recvMem_.get() + i * RECV_BUF_SIZE, RECV_BUF_SIZE, i,
+                              io_uring_buf_ring_mask(RECV_BUFS), i);
+    }
+    io_uring_buf_ring_advance(recvRing_, RECV_BUFS);
+    lent_.reserve(RECV_BUFS);
+    return true;
+}
+
+// 完成事件带有缓冲区时, 记录下来 (下次 Wait 时归还) 并返回其地址
+const char* Epoller::UringRecvBuf_(uint32_t cqeFlags) {
+    if(!(cqeFlags & IORING_CQE_F_BUFFER)) { return nullptr; }
+    uint16_t bid = static_cast<uint16_t>(cqeFlags >> IORING_CQE_BUFFER_SHIFT);
+    lent_.push_back(bid);
+    return recvMem_.get() + static_cast<size_t>(bid) * RECV_BUF_SIZE;
+}
+
+// 获取一个空闲的 SQE, 提交队列满时先提交已有请求
+struct io_uring_sqe* Epoller::UringSqe_() {
+    struct io_uring_sqe* sqe = io_uring_get_sqe(ring_.get());
+    while(!sqe) {
+        io_uring_submit(ring_.get());
+        sqe = io_uring_get_sqe(ring_.get());
+    }
+    return sqe;
+}
+
+// 为 fd 准备一个 poll 请求 (单次触发, 非 ONESHOT 的 fd 在完成后由 Wait 重新挂上);
+// 监听 fd 准备 multishot accept, 直到出错或被撤销前每接受一个连接完成一次
+void Epoller::UringArm_(int fd, UringReg_& reg) {
+    struct io_uring_sqe* sqe = UringSqe_();
+    if(reg.accept && multishotAccept_ && (reg.events & EPOLLIN)) {
+        io_uring_prep_multishot_accept(sqe, fd, nullptr, nullptr, 0);
+        reg.op = URING_ACCEPT;
+    } else {
+        io_uring_prep_poll_add(sqe, fd, reg.events & ~(EPOLLONESHOT | EPOLLET));
+        reg.op = URING_POLL;
+    }
+    sqe->user_data = UringUserData(fd, reg.seq, reg.op);
+    reg.armed = true;
+}
+
+// 撤销 fd 尚未完成的请求. 撤销是异步的: 被撤销的请求之后仍会返回完成事件 (-ECANCELED 或已完成的结果),
+// 由注册序号识别为过期并丢弃; 删除时需要等待的 sendmsg 见 UringCtl_
+void Epoller::UringCancel_(int fd, UringReg_& reg) {
+    struct io_uring_sqe* sqe = UringSqe_();
+    io_uring_prep_cancel64(sqe, UringUserData(fd, reg.seq, reg.op), 0);
+    sqe->user_data = URING_CANCEL_TAG;
+    reg.armed = false;
+}
+
+// 准备为 fd 提交 recv/sendmsg: 只在事件循环线程上 (其它线程的提交会带走该线程准备的请求,
+// 请求的后续处理随之转到其它线程上), 并撤销尚未完成的请求
+Epoller::UringReg_* Epoller::UringIoReg_(int fd, void* ptr) {
+    if(fd < 0 || static_cast<size_t>(fd) >= regs_.size() || !regs_[fd].used ||
+       std::this_thread::get_id() != loopId_) {
+        return nullptr;
+    }
+    UringReg_& reg = regs_[fd];
+    if(reg.armed) { UringCancel_(fd, reg); }
+    reg.seq++;
+    reg.data.ptr = ptr;
+    return &reg;
+}
+
+// 记录为 fd 准备好的 recv/sendmsg, 与下次 Wait 一起提交
+void Epoller::UringSubmitted_(int fd, UringReg_& reg, uint8_t op, struct io_uring_sqe* sqe) {
+    reg.op = op;
+    reg.armed = true;
+    sqe->user_data = UringUserData(fd, reg.seq, op);
+}
+
+// io_uring 版本的 epoll_ctl: 修改时先撤销尚未完成的请求, 再按新的事件重新提交 (没有可读/可写事件时不提交).
+// 删除时 draining 不为空且有尚未完成的 sendmsg, 则保留注册序号等待它结束, 结束时返回 EPOLLHUP 完成事件
+bool Epoller::UringCtl_(int op, int fd, uint32_t events, epoll_data_t data, bool accept, bool* draining) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    if(static_cast<size_t>(fd) >= regs_.size()) {
+        if(op != EPOLL_CTL_ADD) { return false; }
+        regs_.resize(fd + 1);
+    }
+    UringReg_& reg = regs_[fd];
+    if(op == EPOLL_CTL_DEL && draining && (reg.draining || (reg.used && reg.armed && reg.op == URING_SEND))) {
+        if(!reg.draining) {
+            UringCancel_(fd, reg);
+            reg.used = false;
+            reg.draining = true;
+            io_uring_submit(ring_.get());
+        }
+        *draining = true;
+        return true;
+    }
+    if(reg.used == (op == EPOLL_CTL_ADD)) { return false; }    // 与 epoll 一致: 重复添加或修改未注册的 fd 均失败
+    if(reg.armed) { UringCancel_(fd, reg); }
+    reg.seq++;
+    if(op == EPOLL_CTL_ADD) { reg.accept = accept; }
+    if(op == EPOLL_CTL_DEL) {
+        reg.used = false;
+    } else {
+        reg.used = true;
+        reg.events = events;
+        reg.data = data;
+        if(events & (EPOLLIN | EPOLLOUT)) { UringArm_(fd, reg); }
+    }
+    // 删除需要立即生效 (调用者随后会 close fd); 其它线程的修改也要立即提交, 否则事件循环可能一直阻塞在 Wait 中
+    if(op == EPOLL_CTL_DEL || std::this_thread::get_id() != loopId_) {
+        io_uring_submit(ring_.get());
+    }
+    return true;
+}
+
+// io_uring 版本的 epoll_wait: 提交积累的请求, 等待完成事件并转换为 epoll_event
+int Epoller::UringWait_(int timeoutMs) {
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        loopId_ = std::this_thread::get_id();
+        // 上一轮交给调用者的 recv 缓冲区已处理完, 归还缓冲区环
+        for(size_t i = 0; i < lent_.size(); i++) {
+            io_uring_buf_ring_add(recvRing_, recvMem_.get() + static_cast<size_t>(lent_[i]) * RECV_BUF_SIZE, RECV_BUF_SIZE,
+                                  lent_[i], io_uring_buf_ring_mask(RECV_BUFS), static_cast<int>(i));
+        }
+        if(!lent_.empty()) {
+            io_uring_buf_ring_advance(recvRing_, static_cast<int>(lent_.size()));
+            lent_.clear();
+        }
+        io_uring_submit(ring_.get());
+    }
+    struct io_uring_cqe* cqe = nullptr;
+    int ret;
+    if(timeoutMs < 0) {
+        ret = io_uring_wait_cqe(ring_.get(), &cqe);
+    } else {
+        struct __kernel_timespec ts;
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = (timeoutMs % 1000) * 1000000LL;
+        ret = io_uring_wait_cqe_timeout(ring_.get(), &cqe, &ts);
+    }
+    if(ret == -ETIME) { return 0; }
+    if(ret < 0) {
+        errno = -ret;
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> locker(mtx_);
+    size_t n = 0;
+    while(n < events_.size() && io_uring_peek_cqe(ring_.get(), &cqe) == 0) {
+        uint64_t userData = cqe->user_data;
+        int res = cqe->res;
+        uint32_t flags = cqe->flags;
+        bool more = flags & IORING_CQE_F_MORE;                  // multishot 请求仍然有效
+        io_uring_cqe_seen(ring_.get(), cqe);
+        if(userData & URING_CANCEL_TAG) { continue; }
+        const char* buf = UringRecvBuf_(flags);                 // 过期的 recv 读到的数据随之丢弃, 缓冲区同样归还
+        int fd = static_cast<int>(static_cast<uint32_t>(userData));
+        uint16_t seq = static_cast<uint16_t>(userData >> 32);
+        uint8_t op = static_cast<uint8_t>(userData >> 48);
+        UringReg_* reg = static_cast<size_t>(fd) < regs_.size() ? &regs_[fd] : nullptr;
+        // 删除时撤销的 sendmsg 已结束 (被撤销或已完成), 内核不再读取它的数据, 通知调用者完成关闭
+        if(reg && reg->draining && reg->seq == seq && op == URING_SEND) {
+            reg->draining = false;
+            reg->seq++;
+            events_[n].events = EPOLLHUP;
+            events_[n].data = reg->data;
+            results_[n++] = { true, res, nullptr };
+            continue;
+        }
+        // fd 已被删除或修改过, 这是旧请求的完成事件. 已经接受的连接不能丢弃: 监听 fd 仍注册 (如暂停 accept) 时照常返回
+        if(!reg || !reg->used || !reg->armed || reg->seq != seq) {
+            if(op == URING_ACCEPT && res >= 0) {
+                if(reg && reg->used && reg->accept) {
+                    events_[n].events = EPOLLIN;
+                    events_[n].data = reg->data;
+                    results_[n++] = { true, res, nullptr };
+                } else {
+                    close(res);
+                }
+            }
+            continue;
+        }
+        if(!more) { reg->armed = false; }
+        if(res == -ECANCELED) { continue; }
+        if(op == URING_ACCEPT && res == -EINVAL && multishotAccept_) {
+            multishotAccept_ = false;                           // 内核不支持 multishot accept (5.19 之前), 改用 poll 通知
+            UringArm_(fd, *reg);
+            continue;
+        }
+        events_[n].data = reg->data;
+        if(op == URING_POLL) {
+            events_[n].events = res < 0 ? EPOLLERR : static_cast<uint32_t>(res);
+            results_[n++] = { false, 0, nullptr };
+        } else {
+            events_[n].events = op == URING_SEND ? EPOLLOUT : EPOLLIN;
+            results_[n++] = { true, res, buf };
+        }
+        // 非 ONESHOT 的 poll 重新挂上; multishot accept 因出错结束时重新提交
+        if(!reg->armed && ((op == URING_POLL && !(reg->events & EPOLLONESHOT)) || op == URING_ACCEPT)) {
+            UringArm_(fd, *reg);
+        }
+    }
+    return static_cast<int>(n);
+}
+#endif
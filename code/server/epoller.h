@@ -2,35 +2,120 @@
 #define EPOLLER_H
 
 #include <sys/epoll.h>
+#include <sys/socket.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <assert.h>
 #include <vector>
+#include <memory>
 #include <errno.h>
+#ifdef USE_IO_URING
+#include <liburing.h>
+#include <mutex>
+#include <thread>
+#endif
 
 // Epoller 类，封装了 epoll 的操作
+// 编译时定义 USE_IO_URING 后可以选择 io_uring 后端: 用 IORING_OP_POLL_ADD 模拟 epoll 的就绪通知,
+// 接口与语义 (ONESHOT, data.fd/data.ptr) 保持不变; io_uring 不可用时自动回退到 epoll.
+// io_uring 后端还提供完成式操作: 监听 fd 用 multishot accept, 连接直接提交 recv (读入内核从共享缓冲区环中选取的缓冲区)
+// 和 sendmsg, 系统调用由内核完成后随 Wait 返回结果, 事件循环每轮只需一次 io_uring_enter
 class Epoller {
 public:
-    // 构造函数，显式声明避免隐式类型转换
-    explicit Epoller(int maxEvent = 1024);
+    // 构造函数，显式声明避免隐式类型转换, useUring 表示优先使用 io_uring 后端
+    explicit Epoller(int maxEvent = 1024, bool useUring = false);
     // 析构函数
     ~Epoller();
     // 添加 fd 到 epoll 实例中
     bool AddFd(int fd, uint32_t events);
+    // 添加 fd 到 epoll 实例中, 事件携带指针 ptr (同一 fd 只能使用一种形式)
+    bool AddFd(int fd, uint32_t events, void* ptr);
     // 修改 fd 到 epoll 实例中
     bool ModFd(int fd, uint32_t events);
-    // 删除 fd 到 epoll 实例中
-    bool DelFd(int fd);
+    // 修改 fd 到 epoll 实例中, 事件携带指针 ptr
+    bool ModFd(int fd, uint32_t events, void* ptr);
+    // 删除 fd 到 epoll 实例中. draining 不为空时, 尚未完成的 sendmsg 只撤销而不丢弃: *draining 置为 true,
+    // 该请求结束后 Wait 返回一个 EPOLLHUP 完成事件; 在此之前 sendmsg 引用的数据必须保持有效, fd 也不能关闭 (否则可能被新连接占用)
+    bool DelFd(int fd, bool* draining = nullptr);
     // 等待事件发生，timeoutMs 指定超时时间
     int Wait(int timeoutMs = -1);
     // 获取第 i 个事件的 fd
     int GetEventFd(size_t i) const;
+    // 获取第 i 个事件携带的指针
+    void* GetEventPtr(size_t i) const;
     // 获取第 i 个事件的类型
     uint32_t GetEvents(size_t i) const;
+    // 当前使用的后端名称
+    const char* Backend() const;
+
+    // 以下为完成式操作: 请求完成后 Wait 返回一个完成事件 (IsCompletion 为 true), GetResult 为系统调用的返回值
+    // (失败时为 -errno). 只有 io_uring 后端支持, 并且只能在调用 Wait 的线程上提交; 否则返回 false, 调用者改用就绪事件
+    bool HasCompletion() const;                     // 是否支持完成式操作
+    // 添加监听 fd: io_uring 后端注册了可读事件时用 multishot accept 代替 poll, 每接受一个连接返回一个 EPOLLIN 完成事件,
+    // 结果为新连接的 fd (内核不支持 multishot accept 时仍返回就绪事件); epoll 后端与 AddFd 相同
+    bool AddAcceptFd(int fd, uint32_t events, void* ptr);
+    // 为已注册的 fd 提交 recv, 代替一次可读事件, 完成事件为 EPOLLIN. 数据读入内核从共享缓冲区环中选取的缓冲区
+    // (GetRecvBuf), 调用者不需要为等待中的连接预留读缓冲区; 缓冲区用完时结果为 -ENOBUFS. 没有缓冲区环时返回 false
+    bool SubmitRecv(int fd, void* ptr);
+    // 为已注册的 fd 提交 sendmsg, 代替一次可写事件, 完成事件为 EPOLLOUT; 完成之前 msg 及其指向的数据必须保持有效
+    bool SubmitSend(int fd, const struct msghdr* msg, int flags, void* ptr);
+    // 第 i 个事件是否为完成事件
+    bool IsCompletion(size_t i) const;
+    // 第 i 个完成事件的结果
+    int GetResult(size_t i) const;
+    // 第 i 个 recv 完成事件读到的数据 (GetResult 字节), 下次 Wait 时归还缓冲区环
+    const char* GetRecvBuf(size_t i) const;
 
 private:
+    // 执行 epoll_ctl 操作 (或其 io_uring 等价操作)
+    bool Ctl_(int op, int fd, uint32_t events, epoll_data_t data);
+
     int epollFd_;                                   // epoll 实例的 fd
     std::vector<struct epoll_event> events_;        // 用于存储监听 fd 事件类型的数组
+    // 与 events_ 对应的完成结果
+    struct Result_ {
+        bool completed = false;                     // 是否为完成事件 (否则为就绪事件)
+        int res = 0;                                // 系统调用的返回值
+        const char* buf = nullptr;                  // recv 读到的数据所在的缓冲区
+    };
+    std::vector<Result_> results_;
+
+#ifdef USE_IO_URING
+    // io_uring 后端中每个 fd 的注册信息
+    struct UringReg_ {
+        bool used = false;                          // 是否已注册
+        bool armed = false;                         // 是否有尚未完成的请求
+        bool accept = false;                        // 是否为监听 fd (可读时用 multishot accept)
+        bool draining = false;                      // 已删除, 等待撤销的 sendmsg 结束
+        uint8_t op = 0;                             // 尚未完成的请求类型 (poll, accept, recv, sendmsg)
+        uint16_t seq = 0;                           // 注册序号, 每次修改加一, 用于丢弃过期的完成事件
+        uint32_t events = 0;                        // 注册的事件
+        epoll_data_t data;                          // 事件携带的数据
+    };
+    bool InitUring_();                              // 初始化 io_uring, 失败返回 false
+    bool UringCtl_(int op, int fd, uint32_t events, epoll_data_t data, bool accept = false, bool* draining = nullptr);
+    bool InitRecvRing_();                           // 注册 recv 使用的共享缓冲区环, 内核不支持 (5.19 之前) 时返回 false
+    const char* UringRecvBuf_(uint32_t cqeFlags);   // recv 完成事件使用的缓冲区, 记录下来在下次 Wait 时归还
+    int UringWait_(int timeoutMs);
+    void UringArm_(int fd, UringReg_& reg);         // 为 fd 提交一个 poll 请求 (监听 fd 为 multishot accept)
+    void UringCancel_(int fd, UringReg_& reg);      // 撤销 fd 尚未完成的请求
+    UringReg_* UringIoReg_(int fd, void* ptr);      // 准备为 fd 提交 recv/sendmsg, 不能提交时返回 nullptr
+    void UringSubmitted_(int fd, UringReg_& reg, uint8_t op, struct io_uring_sqe* sqe);  // 记录已准备的请求
+    struct io_uring_sqe* UringSqe_();               // 获取一个空闲的 SQE, 队列满时先提交
+
+    std::unique_ptr<struct io_uring> ring_;         // io_uring 实例, 为空表示使用 epoll
+    std::vector<UringReg_> regs_;                   // 以 fd 为下标的注册信息
+    std::mutex mtx_;                                // 保护提交队列和注册信息 (线程池中的线程也会修改 fd)
+    std::thread::id loopId_;                        // 调用 Wait 的线程, 该线程上的修改会合并到下次 Wait 一起提交
+    bool multishotAccept_ = true;                   // 内核是否支持 multishot accept (5.19+), 不支持时监听 fd 改用 poll
+
+    static constexpr unsigned RECV_BUFS = 256;      // 共享缓冲区环中的缓冲区数 (2 的幂)
+    static constexpr unsigned RECV_BUF_SIZE = 4096; // 每个缓冲区的字节数, 更长的请求分多次 recv
+    static constexpr int RECV_GROUP = 0;            // 缓冲区组号
+    struct io_uring_buf_ring* recvRing_ = nullptr;  // recv 的共享缓冲区环, 为空表示不支持 recv
+    std::unique_ptr<char[]> recvMem_;               // 缓冲区环中各缓冲区的内存
+    std::vector<uint16_t> lent_;                    // 上次 Wait 交给调用者的缓冲区, 下次 Wait 时归还
+#endif
 };
 
-#endif //EPOLLER_H
\ No newline at end of file
+#endif //EPOLLER_H
@@ -3,23 +3,68 @@ using namespace std;
 
 // 构造函数
 WebServer::WebServer(int port, int trigMode, int timeoutMS, bool OptLinger, int sqlPort, const char* sqlUser,  const  char* sqlPwd, 
-                    const char* dbName, int connPoolNum, int threadNum, bool openLog,  int logLevel, int logQueSize): 
-                    port_(port), openLinger_(OptLinger), timeoutMS_(timeoutMS),  isClose_(false), timer_(new HeapTimer()),  
-                    threadpool_(new ThreadPool(threadNum)),  epoller_(new Epoller()) {
+                    const char* dbName, int connPoolNum, int threadNum, bool openLog,  int logLevel, int logQueSize, int reactorNum, bool ioUring, bool inlineIO,
+                    const ServerOpt& opt): 
+                    port_(port), openLinger_(OptLinger), timeoutMS_(timeoutMS),  isClose_(false), reactorNum_(reactorNum), inlineIO_(inlineIO || reactorNum > 0), opt_(opt),
+                    threadpool_(new ThreadPool(threadNum)), users_(MAX_FD) {
+    // 初始化日志单例 (先于其它模块, 以便记录初始化过程中的错误)
+    if(openLog) {
+        Log::Instance()->init(logLevel, "./log", ".log", logQueSize);
+    }
     srcDir_ = getcwd(nullptr, 256);         // 获取静态资源地址
     assert(srcDir_);
     strncat(srcDir_, "/resources/", 16); 
     HttpConn::userCount = 0;                // 初始化用户连接数
     HttpConn::srcDir = srcDir_;             // 初始化用户静态资源地址
+    HttpResponse::retryAfter = opt_.retryAfter;
+    HttpConn::tcpCork = opt_.tcpCork;
+    HttpConn::streamWindow = opt_.streamWindow;
+    HttpConn::streamMem = opt_.streamMem;
+    HttpConn::streamCount = 0;
+    // 预加载静态资源, 之后由文件缓存直接引用
+    if(opt_.preload) {
+        AssetStore::Instance()->Load(srcDir_, opt_.preloadFileMax, opt_.preloadMem, opt_.preloadLock);
+    }
+    // 初始化文件缓存, 开始监视资源目录
+    FileCache::Instance()->Init(srcDir_, opt_.fileCacheMem, opt_.fileCacheEntries, opt_.sendfileMin > 0 ? opt_.sendfileMin : 0);
+    GzipCache::Instance()->Init(srcDir_, opt_.gzipMinSize > 0 ? opt_.gzipMinSize : 0, opt_.gzipCacheMem, opt_.gzipLevel);
+    HttpResponse::WarmErrorPages(srcDir_);  // 预先生成错误响应
+    // 不在页缓存中的文件内容交给 I/O 线程读入, 工作线程和事件循环线程不阻塞在磁盘读取上
+    if(opt_.ioThreads > 0 && opt_.prefetchWindow > 0) {
+        ioPool_.reset(new ThreadPool(opt_.ioThreads));
+        HttpConn::prefetchWindow = opt_.prefetchWindow;
+    } else {
+        HttpConn::prefetchWindow = 0;
+    }
+    // 即时压缩交给 I/O 线程 (没有时交给线程池), 事件循环线程不执行 zlib 和文件读取
+    ThreadPool* compressPool = ioPool_ ? ioPool_.get() : threadpool_.get();
+    GzipCache::Instance()->SetExecutor([compressPool](std::function<void()> task) { compressPool->AddTask(std::move(task)); });
+    busyResponse_ = "HTTP/1.1 503 Service Unavailable\r\nRetry-After: " + to_string(opt_.retryAfter) +
+                    "\r\nConnection: close\r\nContent-length: 0\r\n\r\n";
     // 初始化连接池单例
     SqlConnPool::Instance()->Init("localhost", sqlPort, sqlUser, sqlPwd, dbName, connPoolNum);
     // 初始化事件模式
     InitEventMode_(trigMode);
-    // 初始化服务器监听 socket
-    if(!InitSocket_()) { isClose_ = true;}                          
-    // 初始化日志单例
+    // 初始化反应堆及其监听 socket (0 个反应堆线程时, 只在主线程上运行一个反应堆)
+    int loopNum = reactorNum_ > 0 ? reactorNum_ : 1;
+    for(int i = 0; i < loopNum; i++) {
+        reactors_.emplace_back(new Reactor());
+        reactors_.back()->epoller.reset(new Epoller(1024, ioUring));
+        reactors_.back()->timer.reset(new HeapTimer());
+        // 其它线程 (如 I/O 线程) 通过 eventfd 唤醒事件循环, 执行投递的任务
+        reactors_.back()->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if(reactors_.back()->wakeFd < 0 ||
+           !reactors_.back()->epoller->AddFd(reactors_.back()->wakeFd, EPOLLIN, reactors_.back().get())) {
+            LOG_ERROR("Create reactor wakeup fd error!");
+            isClose_ = true;
+            break;
+        }
+        // io_uring 后端且在事件循环线程上读写时, recv/sendmsg 直接提交给内核, 完成后随事件返回
+        reactors_.back()->uringIO = inlineIO_ && reactors_.back()->epoller->HasCompletion();
+        if(!InitSocket_(reactors_.back().get())) { isClose_ = true; break; }
+    }
+    // 记录初始化结果
     if(openLog) {
-        Log::Instance()->init(logLevel, "./log", ".log", logQueSize);
         if(isClose_) { LOG_ERROR("========== Server init error!=========="); }
         else {
             LOG_INFO("========== Server init ==========");
@@ -30,14 +75,35 @@ WebServer::WebServer(int port, int trigMode, int timeoutMS, bool OptLinger, int
             LOG_INFO("LogSys level: %d", logLevel);
             LOG_INFO("srcDir: %s", HttpConn::srcDir);
             LOG_INFO("SqlConnPool num: %d, ThreadPool num: %d", connPoolNum, threadNum);
+            LOG_INFO("Reactor num: %d (%s), Inline IO: %s", loopNum, reactorNum_ > 0 ? "SO_REUSEPORT" : "main loop",
+                            inlineIO_ ? "true" : "false");
+            LOG_INFO("Event backend: %s (requested: %s), completion IO: %s", reactors_[0]->epoller->Backend(),
+                            ioUring ? "io_uring" : "epoll", reactors_[0]->uringIO ? "on" : "off");
+            LOG_INFO("Http scan: %s", HttpScan::Isa());
+            LOG_INFO("Admission: conn watermark %d/%d, max pending tasks %d, Retry-After %ds",
+                            opt_.connHighWater, opt_.connLowWater, opt_.maxPendingTasks, opt_.retryAfter);
+            LOG_INFO("Conn socket: TCP_NODELAY %s, TCP_CORK %s", opt_.tcpNoDelay ? "on" : "off", opt_.tcpCork ? "on" : "off");
+            LOG_INFO("File body: sendfile threshold %d bytes (0: mmap only), stream window %zu KB, total %zu MB",
+                            opt_.sendfileMin, opt_.streamWindow >> 10, opt_.streamMem >> 20);
+            LOG_INFO("File cache: %s, %zu MB mapped, %zu entries", FileCache::Instance()->IsEnabled() ? "on" : "off",
+                            opt_.fileCacheMem >> 20, opt_.fileCacheEntries);
+            LOG_INFO("Gzip: %s, min %d bytes, level %d, cache %zu MB", GzipCache::Instance()->IsEnabled() ? "on" : "off",
+                            opt_.gzipMinSize, opt_.gzipLevel, opt_.gzipCacheMem >> 20);
+            LOG_INFO("Cold file prefetch: %s, %d I/O threads, window %zu KB", ioPool_ ? "on" : "off",
+                            opt_.ioThreads, opt_.prefetchWindow >> 10);
         }
     }
 }
 
 // 析构函数
 WebServer::~WebServer() {
-    close(listenFd_);                                               // 关闭监听文件描述符
+    for(auto& reactor: reactors_) {
+        if(reactor->listenFd >= 0) { close(reactor->listenFd); }   // 关闭监听文件描述符
+        if(reactor->wakeFd >= 0) { close(reactor->wakeFd); }       // 关闭唤醒事件循环的 eventfd
+    }
     isClose_ = true;                                                // 标记服务器关闭
+    GzipCache::Instance()->SetExecutor(nullptr);                    // 线程池随服务器销毁, 之后不再提交压缩任务
+    GzipCache::Instance()->LogStats();                              // 记录即时压缩的统计
     free(srcDir_);                                                  // 释放资源目录字符串
     SqlConnPool::Instance()->ClosePool();                           // 关闭SQL连接池
 }
@@ -69,37 +135,64 @@ void WebServer::InitEventMode_(int trigMode) {
     HttpConn::isET = (connEvent_ & EPOLLET);// 设置客户端是否为边缘触发 (ET)
 }
 
-/*  启动 Web 服务器
+// 启动 Web 服务器: 主线程运行 reactors_[0], 其余反应堆各自占用一个线程
+void WebServer::Start() {
+    if(!isClose_) { LOG_INFO("========== Server start =========="); }
+    std::vector<std::thread> loops;
+    for(size_t i = 1; i < reactors_.size(); i++) {
+        loops.emplace_back(&WebServer::Loop_, this, reactors_[i].get());
+    }
+    Loop_(reactors_[0].get());
+    for(auto& loop: loops) { loop.join(); }
+}
+
+/*  事件循环
     - 现在有一个定时器, 里面装的是所有 fd 的过期剩余时间, 用小根堆来存储, 根节点代表距离过期事件最短。
     - 于是 epoll 实例获取那个最快的过期时间(正数), 并将之前已过期的时间清除(负数)。如果在这期间有事件发生, 就依次进行处理。
     - epoll 会先从事件队列中取出一个事件, 可能是连接事件, 读事件, 写事件, 错误事件, 并进行相应的处理。
+    - 每个反应堆只处理自己 accept 的连接, 连接在其生命周期内不会跨越反应堆
  */
-void WebServer::Start() {
+void WebServer::Loop_(Reactor* reactor) {
     int timeMS = -1;                                    // 下一个定时器距离超时的剩余时间
-    if(!isClose_) { LOG_INFO("========== Server start =========="); }
+    Epoller* epoller = reactor->epoller.get();
     while(!isClose_) {                                  // 服务器没有关闭, 则一直运行
+        if(reactor->listenPaused && HttpConn::userCount < opt_.connLowWater) {
+            ResumeListen_(reactor);                     // 连接数已降到低水位以下, 恢复 accept
+        }
         if(timeoutMS_ > 0) {                            // 超时时间初始化为 6000ms
-            timeMS = timer_->GetNextTick();             // 获取下一个超时时间
+            timeMS = reactor->timer->GetNextTick();     // 获取下一个超时时间
+        }
+        if(reactor->listenPaused && (timeMS < 0 || timeMS > 100)) {
+            timeMS = 100;                               // 暂停 accept 期间定期检查是否可以恢复
         }
-        int eventCnt = epoller_->Wait(timeMS);          // 等待事件发生, 最多阻塞 timeMS, 因为此时已经有事件过期, 把过期 fd 给断开连接
+        int eventCnt = epoller->Wait(timeMS);           // 等待事件发生, 最多阻塞 timeMS, 因为此时已经有事件过期, 把过期 fd 给断开连接
         for(int i = 0; i < eventCnt; i++) {
-            // 处理每个事件
-            int fd = epoller_->GetEventFd(i);
-            uint32_t events = epoller_->GetEvents(i);               // 获取发生事件的 fd
-            if(fd == listenFd_) {
-                DealListen_();                                      // 如果是 lfd， 则处理连接事件
+            // 处理每个事件, 事件携带的指针即连接槽位 (监听 fd 携带 nullptr, 唤醒用的 eventfd 携带反应堆本身)
+            void* ptr = epoller->GetEventPtr(i);
+            if(ptr == reactor) {
+                DoTasks_(reactor);                                  // 其它线程投递了任务
+                continue;
+            }
+            HttpConn* client = static_cast<HttpConn*>(ptr);
+            uint32_t events = epoller->GetEvents(i);                // 获取发生事件的类型
+            if(epoller->IsCompletion(i)) {                          // io_uring 完成事件, 系统调用已由内核完成
+                int res = epoller->GetResult(i);
+                if(!client) { OnAccepted_(reactor, res); }          // 监听 fd: 新连接的 fd
+                else if(events & EPOLLHUP) { client->Close(); }      // 关闭时撤销的 sendmsg 已结束, 完成关闭
+                else if(events & EPOLLIN) { OnRecv_(reactor, client, res, epoller->GetRecvBuf(i)); }
+                else { OnSent_(reactor, client, res); }
+            }
+            else if(!client) {
+                DealListen_(reactor);                               // 如果是 lfd， 则处理连接事件
             }
             else if(events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {  // 处理连接断开、挂起、错误事件
-                assert(users_.count(fd) > 0);
-                CloseConn_(&users_[fd]);
+                CloseConn_(reactor, client);
             }
             else if(events & EPOLLIN) {                             // 处理可读事件
-                assert(users_.count(fd) > 0);
-                DealRead_(&users_[fd]);
+                DealRead_(reactor, client);
             }
             else if(events & EPOLLOUT) {                            // 处理可写事件
-                assert(users_.count(fd) > 0);
-                DealWrite_(&users_[fd]);
+                DealWrite_(reactor, client);
             } else {
                 LOG_ERROR("Unexpected event");                      // 处理未预期事件
             }
@@ -118,24 +211,49 @@ void WebServer::SendError_(int fd, const char*info) {
 }
 
 // 关闭连接
-void WebServer::CloseConn_(HttpConn* client) {
-    assert(client);
+void WebServer::CloseConn_(Reactor* reactor, HttpConn* client) {
+    assert(reactor && client);
     LOG_INFO("Client[%d] quit!", client->GetFd());
-    epoller_->DelFd(client->GetFd());               // 从 epoll 实例中删除 fd
+    ConnTable::Slot* slot = users_.Acquire(client->GetFd());
+    if(slot) { slot->gen++; }                       // 代数加一, 之后执行的过期回调不再作用于这个连接 (即使 fd 尚未被重新占用)
+    bool draining = false;
+    reactor->epoller->DelFd(client->GetFd(), &draining);    // 从 epoll 实例中删除 fd
+    if(draining) {
+        return;                                     // 还有撤销中的 sendmsg 引用写缓冲区, 等它结束后 (EPOLLHUP 完成事件) 再关闭
+    }
     client->Close();                                // 关闭 Http 连接对象
 }
 
+// 连接超时, 只有槽位仍属于添加定时器时的那个连接且尚未关闭 (代数未变) 才关闭
+void WebServer::OnTimeout_(Reactor* reactor, ConnTable::Slot* slot, uint32_t gen) {
+    if(slot->gen.load() == gen) {
+        CloseConn_(reactor, &slot->conn);
+    }
+}
+
 // 添加新客户端
-void WebServer::AddClient_(int fd, sockaddr_in addr) {
+void WebServer::AddClient_(Reactor* reactor, int fd, sockaddr_in addr) {
     assert(fd > 0);
-    users_[fd].init(fd, addr);                      // 初始化 Http 连接对象
+    ConnTable::Slot* slot = users_.Acquire(fd);     // 获取 fd 对应的连接槽位
+    assert(slot);
+    uint32_t gen = ++slot->gen;                     // 槽位被新连接占用, 代数加一 (关闭时也会加一)
+    HttpConn* client = &slot->conn;
+    client->init(fd, addr);                         // 初始化 Http 连接对象
     if(timeoutMS_ > 0) {
         // 如果设置了超时时间，将超时事件及对应的 fd 添加到定时器中
-        timer_->add(fd, timeoutMS_, std::bind(&WebServer::CloseConn_, this, &users_[fd]));
+        reactor->timer->add(fd, timeoutMS_, std::bind(&WebServer::OnTimeout_, this, reactor, slot, gen));
+    }
+    if(reactor->uringIO) {
+        reactor->epoller->AddFd(fd, connEvent_, client);        // 只注册, 由 recv 代替读事件
+        ArmRead_(reactor, client);
+    } else {
+        reactor->epoller->AddFd(fd, EPOLLIN | connEvent_, client);  // 将 fd 添加到 epoll 实例, 监听读事件
     }
-    epoller_->AddFd(fd, EPOLLIN | connEvent_);      // 将 fd 添加到 epoll 实例, 监听读事件
     SetFdNonblock(fd);                              // 设置 fd 为非阻塞模式
-    LOG_INFO("Client[%d] in!", users_[fd].GetFd());
+    if(opt_.tcpNoDelay) {
+        SetSockOpt_(fd, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY");  // 关闭 Nagle 算法
+    }
+    LOG_INFO("Client[%d] in!", client->GetFd());
 }
 
 /*  处理监听事件
@@ -143,91 +261,309 @@ void WebServer::AddClient_(int fd, sockaddr_in addr) {
     - 根据监听到的 cfd, c_addr 来添加 cfd 到 epoll 中, 并更新定时器,等信息
     - 设置 cfd 为 ET 模式, 处理过的连接事件只会通知一次 
 */
-void WebServer::DealListen_() {
+void WebServer::DealListen_(Reactor* reactor) {
     struct sockaddr_in addr;                        // 用于存放客户端的地址信息
     socklen_t len = sizeof(addr);
     do {
         // 将 accept 的客户信息放入 addr 中, 并返回 fd
-        int fd = accept(listenFd_, (struct sockaddr *)&addr, &len); 
+        int fd = accept(reactor->listenFd, (struct sockaddr *)&addr, &len); 
         if(fd <= 0) { return;}
-        else if(HttpConn::userCount >= MAX_FD) {    // 如果当前用户数超过最大值，则发送服务器忙的消息并返回
-            SendError_(fd, "Server busy!");
-            LOG_WARN("Clients is full!");
-            return;
-        }
-        AddClient_(fd, addr);                       // 添加新客户端
+        if(!AcceptConn_(reactor, fd, addr)) { return; }
     } while(listenEvent_ & EPOLLET);                // 如果是边缘触发，则循环接受所有连接
 }
 
+// 接受新连接: 连接数或线程池积压超过上限时返回 503 并关闭; 返回 false 表示暂时不再 accept
+bool WebServer::AcceptConn_(Reactor* reactor, int fd, const sockaddr_in& addr) {
+    if(HttpConn::userCount >= MAX_FD || fd >= MAX_FD) {        // 如果当前用户数超过最大值，则发送 503 并返回
+        SendError_(fd, busyResponse_.c_str());
+        LOG_WARN("Clients is full!");
+        return false;
+    }
+    else if(threadpool_->TaskCount() >= static_cast<size_t>(opt_.maxPendingTasks)) {
+        SendError_(fd, busyResponse_.c_str());      // 线程池积压过多, 尽早拒绝新连接
+        LOG_WARN("ThreadPool is busy!");
+        return false;
+    }
+    AddClient_(reactor, fd, addr);                  // 添加新客户端
+    if(HttpConn::userCount >= opt_.connHighWater) {
+        PauseListen_(reactor);                      // 连接数达到高水位, 暂停 accept, 新连接留在内核的 backlog 中
+        return false;
+    }
+    return true;
+}
+
+// multishot accept 接受了一个连接 (fd 为负数时是 -errno). 完成事件不带地址, 由 getpeername 取得
+void WebServer::OnAccepted_(Reactor* reactor, int fd) {
+    if(fd < 0) {
+        LOG_WARN("Accept error: %d", -fd);
+        return;
+    }
+    struct sockaddr_in addr = {};
+    socklen_t len = sizeof(addr);
+    getpeername(fd, (struct sockaddr *)&addr, &len);
+    AcceptConn_(reactor, fd, addr);
+}
+
+// 暂停 accept: 不再监听 listenFd 的可读事件
+void WebServer::PauseListen_(Reactor* reactor) {
+    if(reactor->listenPaused) { return; }
+    reactor->epoller->ModFd(reactor->listenFd, 0, nullptr);
+    reactor->listenPaused = true;
+    LOG_WARN("Listen paused, userCount:%d", (int)HttpConn::userCount);
+}
+
+// 恢复 accept
+void WebServer::ResumeListen_(Reactor* reactor) {
+    reactor->epoller->ModFd(reactor->listenFd, listenEvent_ | EPOLLIN, nullptr);
+    reactor->listenPaused = false;
+    LOG_INFO("Listen resumed, userCount:%d", (int)HttpConn::userCount);
+}
+
 // 处理读事件
-void WebServer::DealRead_(HttpConn* client) {
+void WebServer::DealRead_(Reactor* reactor, HttpConn* client) {
     assert(client);
-    ExtentTime_(client);                            // 如果发生读写事件, 则更新定时器, 重置超时时间
+    ExtentTime_(reactor, client);                   // 如果发生读写事件, 则更新定时器, 重置超时时间
+    if(inlineIO_) {
+        OnRead_(reactor, client);                   // 内联模式, 直接在事件循环线程上读取
+        return;
+    }
+    if(threadpool_->TaskCount() >= static_cast<size_t>(opt_.maxPendingTasks)) {
+        RejectBusy_(reactor, client);               // 线程池积压过多, 不再排队
+        return;
+    }
     // 将读任务添加到线程池, 等待工作线程进行处理
-    threadpool_->AddTask(std::bind(&WebServer::OnRead_, this, client));
+    threadpool_->AddTask(std::bind(&WebServer::OnRead_, this, reactor, client));
+}
+
+// 线程池积压过多时拒绝请求: 在事件循环线程上读出请求, 直接写出 503 并关闭连接 (不经过线程池)
+void WebServer::RejectBusy_(Reactor* reactor, HttpConn* client) {
+    int readErrno = 0;
+    if(client->read(&readErrno) <= 0 && readErrno != EAGAIN) {
+        CloseConn_(reactor, client);
+        return;
+    }
+    LOG_WARN("ThreadPool is busy, reject client[%d]", client->GetFd());
+    client->Reject(503);
+    OnWrite_(reactor, client);
 }
 
 // 处理写事件
-void WebServer::DealWrite_(HttpConn* client) {
+void WebServer::DealWrite_(Reactor* reactor, HttpConn* client) {
     assert(client);
-    ExtentTime_(client);                            // 如果发生读写事件, 则更新定时器, 重置超时时间
+    ExtentTime_(reactor, client);                   // 如果发生读写事件, 则更新定时器, 重置超时时间
+    if(inlineIO_) {
+        OnWrite_(reactor, client);                  // 内联模式, 直接在事件循环线程上写入
+        return;
+    }
     // 将写任务添加到线程池, 等待工作线程进行处理
-    threadpool_->AddTask(std::bind(&WebServer::OnWrite_, this, client));
+    threadpool_->AddTask(std::bind(&WebServer::OnWrite_, this, reactor, client));
 }
 
 // 延长客户端的超时时间
-void WebServer::ExtentTime_(HttpConn* client) {
+void WebServer::ExtentTime_(Reactor* reactor, HttpConn* client) {
     assert(client);
     // 调整客户端在定时器中的时间
-    if(timeoutMS_ > 0) { timer_->adjust(client->GetFd(), timeoutMS_); }
+    if(timeoutMS_ > 0) { reactor->timer->adjust(client->GetFd(), timeoutMS_); }
 }
 
 // 读取数据
-void WebServer::OnRead_(HttpConn* client) {
+void WebServer::OnRead_(Reactor* reactor, HttpConn* client) {
     assert(client);
     int ret = -1;
     int readErrno = 0;
     ret = client->read(&readErrno);                                 // 读取数据
     if(ret <= 0 && readErrno != EAGAIN) {
-        CloseConn_(client);                                         // 如果读取出错并且错误不是EAGAIN，则关闭连接
+        CloseConn_(reactor, client);                                // 如果读取出错并且错误不是EAGAIN，则关闭连接
         return;
     }
-    OnProcess(client);                                              // 处理读取到的数据 (解析 HTTP 请求)
+    DealProcess_(reactor, client);                                  // 处理读取到的数据 (解析 HTTP 请求)
+}
+
+// 分派请求处理: 内联模式下静态文件、错误页等请求直接在事件循环线程上完成,
+// 只有需要阻塞的请求 (登录/注册查询数据库) 才交给线程池 (非内联模式下已经在工作线程上)
+void WebServer::DealProcess_(Reactor* reactor, HttpConn* client) {
+    if(client->IsBlocking()) {
+        // 数据库连接耗尽 (内联模式下还有线程池积压过多) 时不再排队等待, 直接返回 503
+        if(SqlConnPool::Instance()->GetFreeConnCount() == 0 ||
+           (inlineIO_ && threadpool_->TaskCount() >= static_cast<size_t>(opt_.maxPendingTasks))) {
+            client->Reject(503);
+            ArmWrite_(reactor, client);
+            return;
+        }
+        if(!inlineIO_) {
+            OnProcess(reactor, client);
+            return;
+        }
+        // 处理期间连接不在定时器中 (超时关闭会与工作线程同时访问连接, 甚至被新连接重新初始化),
+        // 处理完成后回到事件循环线程重新加入定时器并注册事件 (io_uring 的 recv/sendmsg 只能由事件循环线程提交)
+        int fd = client->GetFd();
+        ConnTable::Slot* slot = users_.Acquire(fd);
+        uint32_t gen = slot->gen.load();
+        if(timeoutMS_ > 0) { reactor->timer->cancel(fd); }
+        threadpool_->AddTask([this, reactor, client, fd, slot, gen] {
+            bool ok = client->process();
+            RunInLoop_(reactor, [this, reactor, client, fd, slot, gen, ok] {
+                if(slot->gen.load() != gen) { return; }
+                if(timeoutMS_ > 0) {
+                    reactor->timer->add(fd, timeoutMS_, std::bind(&WebServer::OnTimeout_, this, reactor, slot, gen));
+                }
+                if(ok) { ArmWrite_(reactor, client); }
+                else { ArmRead_(reactor, client); }
+            });
+        });
+        return;
+    }
+    OnProcess(reactor, client);
 }
 
 // 处理客户端请求
-void WebServer::OnProcess(HttpConn* client) {
+void WebServer::OnProcess(Reactor* reactor, HttpConn* client) {
     if(client->process()) {
-        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT);    // 如果处理成功，则注册写事件
+        ArmWrite_(reactor, client);                 // 如果处理成功，则等待发送响应
     } else {
-        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLIN);     // 否则注册读事件
+        ArmRead_(reactor, client);                  // 否则等待更多请求数据
+    }
+}
+
+// 等待请求数据: io_uring 完成式读写时提交 recv (等待期间不占用缓冲区); 否则注册读事件
+void WebServer::ArmRead_(Reactor* reactor, HttpConn* client) {
+    if(reactor->uringIO && reactor->epoller->SubmitRecv(client->GetFd(), client)) {
+        return;
+    }
+    reactor->epoller->ModFd(client->GetFd(), connEvent_ | EPOLLIN, client);
+}
+
+// 等待发送响应: io_uring 完成式读写且写缓冲区开头是内存数据时提交 sendmsg;
+// 否则 (sendfile 片段, 需要先读入的文件内容) 注册写事件, 由 OnWrite_ 写出
+void WebServer::ArmWrite_(Reactor* reactor, HttpConn* client) {
+    if(reactor->uringIO) {
+        int flags;
+        const struct msghdr* msg = client->PrepareSend(&flags);
+        if(msg && reactor->epoller->SubmitSend(client->GetFd(), msg, flags, client)) { return; }
+    }
+    reactor->epoller->ModFd(client->GetFd(), connEvent_ | EPOLLOUT, client);
+}
+
+// recv 完成: res 为读到的字节数 (数据在 buf 中), 0 表示对端关闭, 负数为 -errno
+void WebServer::OnRecv_(Reactor* reactor, HttpConn* client, int res, const char* buf) {
+    ExtentTime_(reactor, client);
+    if(res == -EAGAIN || res == -EINTR) {
+        ArmRead_(reactor, client);
+        return;
+    }
+    if(res == -ENOBUFS) {
+        // 共享缓冲区暂时用完, 这一次改为等待可读事件, 由 OnRead_ 读入读缓冲区
+        reactor->epoller->ModFd(client->GetFd(), connEvent_ | EPOLLIN, client);
+        return;
+    }
+    if(res <= 0) {
+        CloseConn_(reactor, client);
+        return;
+    }
+    client->RecvDone(buf, res);
+    DealProcess_(reactor, client);                  // 处理读取到的数据 (解析 HTTP 请求)
+}
+
+// sendmsg 完成: 还有数据时继续发送; 全部发送完后与 OnWrite_ 相同, 保持连接时处理下一批请求
+void WebServer::OnSent_(Reactor* reactor, HttpConn* client, int res) {
+    ExtentTime_(reactor, client);
+    if(res == -EAGAIN || res == -EINTR) {
+        ArmWrite_(reactor, client);
+        return;
+    }
+    if(res <= 0) {
+        CloseConn_(reactor, client);
+        return;
+    }
+    client->SendDone(res);
+    if(client->ToWriteBytes() > 0) {
+        ArmWrite_(reactor, client);
+        return;
+    }
+    if(client->IsKeepAlive()) {
+        DealProcess_(reactor, client);
+        return;
     }
+    CloseConn_(reactor, client);
 }
 
 // 写入数据
-void WebServer::OnWrite_(HttpConn* client) {
+void WebServer::OnWrite_(Reactor* reactor, HttpConn* client) {
     assert(client);                                                 // 断言客户端不为空
     int ret = -1;
     int writeErrno = 0;
     ret = client->write(&writeErrno);                               // 写入数据
     if(client->ToWriteBytes() == 0) {                               // 如果数据传输完成
         if(client->IsKeepAlive()) {                                 // 如果保持连接，则继续处理客户端请求
-            OnProcess(client);                                      
+            DealProcess_(reactor, client);
             return;
         }
     }
     else if(ret < 0) {
         if(writeErrno == EAGAIN) {                                  // 如果写入出错并且错误是EAGAIN，则继续写入数据 (ET)
-            epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT);
+            ArmWrite_(reactor, client);
+            return;
+        }
+        if(writeErrno == EINPROGRESS) {                             // 待发送的文件内容不在内存中
+            Prefetch_(reactor, client);
             return;
         }
     }
-    CloseConn_(client);                                             // 关闭连接
+    CloseConn_(reactor, client);                                    // 关闭连接
+}
+
+// 把待发送的文件内容读入页缓存后重新注册写事件. 读取在 I/O 线程中进行, 期间连接不注册任何事件 (EPOLLONESHOT),
+// 其它连接的请求照常处理. I/O 线程持有文件的引用, 读完后把重新注册交回反应堆的事件循环线程:
+// 超时关闭也在该线程上执行, 检查代数与注册之间不会有连接被关闭、fd 被新连接占用
+void WebServer::Prefetch_(Reactor* reactor, HttpConn* client) {
+    off_t off;
+    size_t len;
+    FileCache::EntryPtr file = client->ColdRange(&off, &len);
+    int fd = client->GetFd();
+    ConnTable::Slot* slot = users_.Acquire(fd);
+    uint32_t gen = slot->gen.load();
+    ioPool_->AddTask([this, reactor, client, file, off, len, fd, slot, gen] {
+        FileCache::Prefetch(*file, off, len);
+        RunInLoop_(reactor, [this, reactor, client, slot, gen] {
+            if(slot->gen.load() == gen) {
+                ArmWrite_(reactor, client);
+            }
+        });
+    });
+}
+
+// 投递任务到反应堆的事件循环线程, 通过 eventfd 唤醒等待中的 Wait
+void WebServer::RunInLoop_(Reactor* reactor, std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> locker(reactor->taskMtx);
+        reactor->tasks.push_back(std::move(task));
+    }
+    uint64_t one = 1;
+    if(write(reactor->wakeFd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        LOG_ERROR("Wake up reactor error: %d", errno);
+    }
+}
+
+// 执行投递的任务: 先清空 eventfd 的计数, 再取出全部任务 (之后投递的会再次唤醒)
+void WebServer::DoTasks_(Reactor* reactor) {
+    uint64_t cnt;
+    if(read(reactor->wakeFd, &cnt, sizeof(cnt)) < 0 && errno != EAGAIN) {
+        LOG_ERROR("Read reactor wakeup fd error: %d", errno);
+    }
+    std::vector<std::function<void()>> tasks;
+    {
+        std::lock_guard<std::mutex> locker(reactor->taskMtx);
+        tasks.swap(reactor->tasks);
+    }
+    for(auto& task : tasks) {
+        task();
+    }
 }
 
 // 初始化服务端的 socket
-bool WebServer::InitSocket_() {
+bool WebServer::InitSocket_(Reactor* reactor) {
     int ret;
+    int listenFd;
     struct sockaddr_in addr;                // 存放服务端 socket 的地址信息
     if(port_ > 65535 || port_ < 1024) {     // 检查服务器端口号是否有效
         LOG_ERROR("Port:%d error!",  port_);
@@ -244,50 +580,89 @@ bool WebServer::InitSocket_() {
         optLinger.l_linger = 1;
     }
     // 创建监听 socket, 用于监听连接
-    listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
-    if(listenFd_ < 0) {
+    listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if(listenFd < 0) {
         LOG_ERROR("Create socket error!", port_);
         return false;
     }
     // 设置套接字选项, 这里设置的是优雅关闭
-    ret = setsockopt(listenFd_, SOL_SOCKET, SO_LINGER, &optLinger, sizeof(optLinger));
+    ret = setsockopt(listenFd, SOL_SOCKET, SO_LINGER, &optLinger, sizeof(optLinger));
     if(ret < 0) {
-        close(listenFd_);
+        close(listenFd);
         LOG_ERROR("Init linger error!", port_);
         return false;
     }
     // 设置套接字选项, 这里设置的是端口复用
     int optval = 1;
-    ret = setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, (const void*)&optval, sizeof(int));
+    ret = setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, (const void*)&optval, sizeof(int));
     if(ret == -1) {
         LOG_ERROR("set socket setsockopt error !");
-        close(listenFd_);
+        close(listenFd);
         return false;
     }
+    // 多反应堆模式下每个反应堆绑定同一端口, 由内核在这些监听 socket 间分发新连接
+    if(reactorNum_ > 0) {
+        ret = setsockopt(listenFd, SOL_SOCKET, SO_REUSEPORT, (const void*)&optval, sizeof(int));
+        if(ret == -1) {
+            LOG_ERROR("set socket SO_REUSEPORT error !");
+            close(listenFd);
+            return false;
+        }
+    }
+    // 收发缓冲区需要在 listen 之前设置 (接收窗口的缩放因子在握手时确定), 已连接 socket 会继承
+    if(opt_.sndBuf > 0) { SetSockOpt_(listenFd, SOL_SOCKET, SO_SNDBUF, opt_.sndBuf, "SO_SNDBUF"); }
+    if(opt_.rcvBuf > 0) { SetSockOpt_(listenFd, SOL_SOCKET, SO_RCVBUF, opt_.rcvBuf, "SO_RCVBUF"); }
     // 将服务端的 Socket 地址信息绑定到 listenFd 上
-    ret = bind(listenFd_, (struct sockaddr *)&addr, sizeof(addr));
+    ret = bind(listenFd, (struct sockaddr *)&addr, sizeof(addr));
     if(ret < 0) {
         LOG_ERROR("Bind Port:%d error!", port_);
-        close(listenFd_);
+        close(listenFd);
         return false;
     }
+    // 延迟 accept 直到客户端发来数据; 开启 TCP Fast Open
+    if(opt_.deferAccept > 0) { SetSockOpt_(listenFd, IPPROTO_TCP, TCP_DEFER_ACCEPT, opt_.deferAccept, "TCP_DEFER_ACCEPT"); }
+    if(opt_.fastOpen > 0) { SetSockOpt_(listenFd, IPPROTO_TCP, TCP_FASTOPEN, opt_.fastOpen, "TCP_FASTOPEN"); }
     // 将 listenFd 切换为监听状态
-    ret = listen(listenFd_, 6);
+    ret = listen(listenFd, opt_.backlog);
     if(ret < 0) {
         LOG_ERROR("Listen port:%d error!", port_);
-        close(listenFd_);
+        close(listenFd);
         return false;
     }
     // 将 listenFd 添加到 epoll 实例 (可读事件)
-    ret = epoller_->AddFd(listenFd_,  listenEvent_ | EPOLLIN);
+    ret = reactor->epoller->AddAcceptFd(listenFd,  listenEvent_ | EPOLLIN, nullptr);
     if(ret == 0) {
         LOG_ERROR("Add listen error!");
-        close(listenFd_);
+        close(listenFd);
         return false;
     }
     // 设置 listenFd 为非阻塞模式
-    SetFdNonblock(listenFd_);
+    SetFdNonblock(listenFd);
+    reactor->listenFd = listenFd;
     LOG_INFO("Server port:%d", port_);
+    // 记录实际生效的监听 socket 参数 (内核可能调整设置值, 如 SO_SNDBUF 翻倍, backlog 受 somaxconn 限制)
+    int somaxconn = 0, sndBuf = 0, rcvBuf = 0, deferAccept = 0, fastOpen = 0;
+    socklen_t optLen = sizeof(int);
+    FILE* fp = fopen("/proc/sys/net/core/somaxconn", "r");
+    if(fp) {
+        if(fscanf(fp, "%d", &somaxconn) != 1) { somaxconn = 0; }
+        fclose(fp);
+    }
+    getsockopt(listenFd, SOL_SOCKET, SO_SNDBUF, &sndBuf, &optLen);
+    getsockopt(listenFd, SOL_SOCKET, SO_RCVBUF, &rcvBuf, &optLen);
+    getsockopt(listenFd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &deferAccept, &optLen);
+    getsockopt(listenFd, IPPROTO_TCP, TCP_FASTOPEN, &fastOpen, &optLen);
+    LOG_INFO("Listen socket: backlog %d (somaxconn %d), SO_SNDBUF %d, SO_RCVBUF %d, TCP_DEFER_ACCEPT %d, TCP_FASTOPEN %d",
+                    opt_.backlog, somaxconn, sndBuf, rcvBuf, deferAccept, fastOpen);
+    return true;
+}
+
+// 设置整型 socket 选项, 调优选项设置失败不影响服务器运行, 只记录警告
+bool WebServer::SetSockOpt_(int fd, int level, int name, int val, const char* label) {
+    if(setsockopt(fd, level, name, &val, sizeof(val)) < 0) {
+        LOG_WARN("set %s=%d on fd %d error: %s", label, val, fd, strerror(errno));
+        return false;
+    }
     return true;
 }
 
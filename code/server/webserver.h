@@ -1,15 +1,21 @@
 #ifndef WEBSERVER_H
 #define WEBSERVER_H
 
-#include <unordered_map>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <functional>
 #include <fcntl.h>
 #include <unistd.h>
 #include <assert.h>
 #include <errno.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
+#include <sys/eventfd.h>
 #include "epoller.h"
+#include "conntable.h"
 #include "../log/log.h"
 #include "../timer/heaptimer.h"
 #include "../pool/sqlconnpool.h"
@@ -17,46 +23,114 @@
 #include "../pool/sqlconnRAII.h"
 #include "../http/httpconn.h"
 
+// 服务器的可选调优参数
+struct ServerOpt {
+    // 过载保护 (准入控制)
+    int connHighWater = 60000;                      // 连接数达到该值时暂停 accept
+    int connLowWater = 50000;                       // 连接数降到该值以下时恢复 accept
+    int maxPendingTasks = 10000;                    // 线程池积压任务上限, 超过后新连接和排队的请求直接返回 503
+    int retryAfter = 1;                             // 503 响应中 Retry-After 的秒数
+
+    // socket 选项
+    int backlog = 1024;                             // listen 的 backlog (实际值不超过 net.core.somaxconn)
+    bool tcpNoDelay = true;                         // 已连接 socket 开启 TCP_NODELAY, 避免 keep-alive 响应受 Nagle 算法延迟
+    int deferAccept = 0;                            // TCP_DEFER_ACCEPT 秒数, 客户端发来数据后才唤醒 accept, 0 表示关闭
+    int fastOpen = 0;                               // TCP_FASTOPEN 队列长度, 0 表示关闭
+    int sndBuf = 0;                                 // SO_SNDBUF 字节数, 设置在监听 socket 上由连接继承, 0 表示系统默认
+    int rcvBuf = 0;                                 // SO_RCVBUF 字节数, 同上
+    bool tcpCork = false;                           // 写响应期间开启 TCP_CORK, 响应头与文件内容合并成满的报文段
+
+    // 响应发送与文件缓存
+    int sendfileMin = 64 * 1024;                    // 文件不小于该字节数时用 sendfile 零拷贝发送, 较小的用 mmap + writev; 0 表示总是 mmap
+    size_t fileCacheMem = 64 << 20;                 // 文件缓存中内存映射的总大小上限, 0 表示不缓存 (每次请求都访问文件系统)
+    size_t fileCacheEntries = 4096;                 // 文件缓存的条目数上限 (包括不存在的文件)
+    int gzipMinSize = 1024;                         // 没有预压缩文件时, 不小于该字节数的文本响应即时 gzip 压缩, 0 表示关闭
+    size_t gzipCacheMem = 16 << 20;                 // 即时压缩结果缓存的总大小上限 (超过 1/4 的文件不压缩)
+    int gzipLevel = 6;                              // 即时压缩的级别 (1-9)
+    int ioThreads = 2;                              // 读入不在页缓存中的文件内容 (以及即时压缩) 的 I/O 线程数, 0 表示不检查 (发送时可能阻塞在磁盘读取上, 压缩交给线程池)
+    size_t prefetchWindow = 1 << 20;                // 发送文件前每次确认在内存中 (否则交给 I/O 线程读入) 的字节数
+    size_t streamWindow = 256 << 10;                // 发送大文件 (sendfile) 的连接每轮最多写出的字节数, 也是内核中未发送数据的上限
+    size_t streamMem = 64 << 20;                    // 所有发送大文件的连接的窗口总和上限, 连接多时平分 (每个不少于 16 KB)
+
+    // 启动时预加载静态资源 (避免部署后页缓存为空时的磁盘读取)
+    bool preload = false;                           // 是否在启动时把资源文件读入内存
+    size_t preloadFileMax = 1 << 20;                // 预加载的单个文件大小上限, 更大的文件走普通路径
+    size_t preloadMem = 64 << 20;                   // 预加载的总大小上限
+    bool preloadLock = false;                       // 是否 mlock 预加载的内存 (需要足够的 RLIMIT_MEMLOCK)
+};
+
 // 服务器类
 class WebServer {
 public:
     // 构造函数
     WebServer(int port, int trigMode, int timeoutMS, bool OptLinger,  int sqlPort, const char* sqlUser, const  char* sqlPwd, 
-        const char* dbName, int connPoolNum, int threadNum, bool openLog, int logLevel, int logQueSize);
+        const char* dbName, int connPoolNum, int threadNum, bool openLog, int logLevel, int logQueSize, int reactorNum = 0, bool ioUring = false, bool inlineIO = false,
+        const ServerOpt& opt = ServerOpt());
     ~WebServer();
     void Start();                                   // 启动服务器
 
 private:
-    bool InitSocket_();                             // 初始化 socket
+    // 反应堆: 独占一个 Epoller, 一个定时器, 一个监听 fd, 并负责由它接受的连接
+    struct Reactor {
+        int listenFd = -1;                              // 监听 fd (多反应堆模式下各自开启 SO_REUSEPORT)
+        std::unique_ptr<Epoller> epoller;               // Epoll 实例
+        std::unique_ptr<HeapTimer> timer;               // 小根堆定时器
+        bool listenPaused = false;                      // 是否因连接数过多暂停了 accept
+        bool uringIO = false;                           // 是否用 io_uring 完成式读写 (内联模式下 recv/sendmsg 由内核完成后通知)
+        int wakeFd = -1;                                // eventfd, 其它线程投递任务后唤醒事件循环 (事件携带 Reactor 指针)
+        std::mutex taskMtx;                             // 保护 tasks
+        std::vector<std::function<void()>> tasks;       // 投递给事件循环线程执行的任务
+    };
+
+    bool InitSocket_(Reactor* reactor);             // 初始化 socket
     void InitEventMode_(int trigMode);              // 初始化事件模式
-    void AddClient_(int fd, sockaddr_in addr);      // 添加客户端
-    void DealListen_();                             // 处理监听事件
-    void DealWrite_(HttpConn* client);              // 处理写事件
-    void DealRead_(HttpConn* client);               // 处理读事件
+    void Loop_(Reactor* reactor);                   // 事件循环
+    void AddClient_(Reactor* reactor, int fd, sockaddr_in addr);  // 添加客户端
+    void DealListen_(Reactor* reactor);             // 处理监听事件
+    bool AcceptConn_(Reactor* reactor, int fd, const sockaddr_in& addr);  // 接受新连接, 返回 false 表示暂时不再 accept
+    void PauseListen_(Reactor* reactor);            // 暂停 accept
+    void ResumeListen_(Reactor* reactor);           // 恢复 accept
+    void DealWrite_(Reactor* reactor, HttpConn* client);    // 处理写事件
+    void DealRead_(Reactor* reactor, HttpConn* client);     // 处理读事件
+    void RejectBusy_(Reactor* reactor, HttpConn* client);   // 线程池积压过多, 以 503 拒绝请求
     void SendError_(int fd, const char*info);       // 发送错误信息
-    void ExtentTime_(HttpConn* client);             // 延长客户端时间
-    void CloseConn_(HttpConn* client);              // 关闭连接
-    void OnRead_(HttpConn* client);                 // 读取数据处理
-    void OnWrite_(HttpConn* client);                // 写入数据处理
-    void OnProcess(HttpConn* client);               // 处理请求
+    void ExtentTime_(Reactor* reactor, HttpConn* client);   // 延长客户端时间
+    void CloseConn_(Reactor* reactor, HttpConn* client);    // 关闭连接
+    void OnTimeout_(Reactor* reactor, ConnTable::Slot* slot, uint32_t gen); // 连接超时
+    void OnRead_(Reactor* reactor, HttpConn* client);       // 读取数据处理
+    void OnWrite_(Reactor* reactor, HttpConn* client);      // 写入数据处理
+    void DealProcess_(Reactor* reactor, HttpConn* client);  // 分派请求处理 (内联或交给线程池)
+    void OnProcess(Reactor* reactor, HttpConn* client);     // 处理请求
+    void Prefetch_(Reactor* reactor, HttpConn* client);     // 待发送的文件内容不在内存中, 交给 I/O 线程读入
+    void ArmRead_(Reactor* reactor, HttpConn* client);      // 等待请求数据 (提交 recv 或注册读事件)
+    void ArmWrite_(Reactor* reactor, HttpConn* client);     // 等待发送响应 (提交 sendmsg 或注册写事件)
+    void OnAccepted_(Reactor* reactor, int fd);             // multishot accept 完成
+    void OnRecv_(Reactor* reactor, HttpConn* client, int res, const char* buf);  // recv 完成
+    void OnSent_(Reactor* reactor, HttpConn* client, int res);  // sendmsg 完成
+    void RunInLoop_(Reactor* reactor, std::function<void()> task);  // 投递任务到反应堆的事件循环线程执行
+    void DoTasks_(Reactor* reactor);                // 在事件循环线程上执行投递的任务
 
     static const int MAX_FD = 65536;                // 最大 fd 数量
     static int SetFdNonblock(int fd);               // 设置 fd 为非阻塞模式
+    static bool SetSockOpt_(int fd, int level, int name, int val, const char* label);  // 设置整型 socket 选项, 失败时记录警告
 
     int port_;                                      // 服务器端口
     bool openLinger_;                               // 是否开启优雅关闭
     int timeoutMS_;                                 // 超时时间（毫秒）
     bool isClose_;                                  // 是否关闭服务器
-    int listenFd_;                                  // 监听 fd 
+    int reactorNum_;                                // 反应堆线程数 (0 表示单反应堆 + 线程池)
+    bool inlineIO_;                                 // 是否在事件循环线程上直接读写和处理请求 (只把阻塞请求交给线程池)
+    ServerOpt opt_;                                 // 调优参数
+    std::string busyResponse_;                      // 过载时发给新连接的 503 响应
     char* srcDir_;                                  // 静态资源目录
     
     uint32_t listenEvent_;                          // 监听事件
     uint32_t connEvent_;                            // 连接事件
    
-    std::unique_ptr<HeapTimer> timer_;              // 小根堆定时器
     std::unique_ptr<ThreadPool> threadpool_;        // 线程池
-    std::unique_ptr<Epoller> epoller_;              // Epoll 实例
-    std::unordered_map<int, HttpConn> users_;       // 用 map 存储 fd 到 HTTPCONN 的映射
+    std::unique_ptr<ThreadPool> ioPool_;            // I/O 线程池, 只做磁盘读取和即时压缩, 不与请求处理争用线程
+    std::vector<std::unique_ptr<Reactor>> reactors_;// 反应堆, reactors_[0] 运行在调用 Start 的线程上
+    ConnTable users_;                               // 以 fd 为下标的连接表, 所有反应堆共享 (fd 在进程内唯一)
 };
 
 #endif //WEBSERVER_H
\ No newline at end of file
@@ -3,13 +3,12 @@
 // 向上调整堆
 void HeapTimer::siftup_(size_t i) {
     assert(i >= 0 && i < heap_.size());
-    size_t j = (i - 1) / 2;                             // 父节点索引
-    // 当不是根节点且当前节点小于父节点时，向上调整
-    while(j >= 0) {
+    // 当不是根节点且当前节点小于父节点时，向上调整 (i 为 size_t, 根节点没有父节点, 不能计算 (0 - 1) / 2)
+    while(i > 0) {
+        size_t j = (i - 1) / 2;                         // 父节点索引
         if(heap_[j] < heap_[i]) { break; }
         SwapNode_(i, j);                                // 交换节点
         i = j;
-        j = (i - 1) / 2;
     }
 }
 
@@ -73,6 +72,14 @@ void HeapTimer::doWork(int id) {
     del_(i);
 }
 
+// 删除指定 id 的定时器 (不存在时忽略), 不执行回调
+void HeapTimer::cancel(int id) {
+    if(ref_.count(id) == 0) {
+        return;
+    }
+    del_(ref_[id]);
+}
+
 // 删除指定索引的定时器
 void HeapTimer::del_(size_t index) {
     assert(!heap_.empty() && index >= 0 && index < heap_.size());
@@ -36,6 +36,7 @@ public:
     // 添加定时器
     void add(int id, int timeOut, const TimeoutCallBack& cb);
     void doWork(int id);
+    void cancel(int id);                            // 删除指定 id 的定时器, 不执行回调
     void clear();
     void tick();
     void pop();